@@ -235,6 +235,61 @@ static TranslationBlock *tb_htable_lookup(CPUState *cpu, vaddr pc,
     return qht_lookup_custom(&tb_ctx.htable, &desc, h, tb_lookup_cmp);
 }
 
+static TranslationBlock *tb_jmp_cache_l2_lookup(CPUJumpCache *jc, vaddr pc,
+                                                uint64_t cs_base,
+                                                uint32_t flags,
+                                                uint32_t cflags)
+{
+    CPUJumpCacheEntry *set;
+    unsigned i;
+
+    set = &jc->l2[tb_jmp_cache_hash_func(pc, jc->l2_bits) * jc->l2_ways];
+    for (i = 0; i < jc->l2_ways; i++) {
+        TranslationBlock *tb = qatomic_read(&set[i].tb);
+
+        if (tb &&
+            set[i].pc == pc &&
+            tb->cs_base == cs_base &&
+            tb->flags == flags &&
+            tb_cflags(tb) == cflags) {
+            return tb;
+        }
+    }
+    return NULL;
+}
+
+static void tb_jmp_cache_l2_insert(CPUJumpCache *jc, vaddr pc,
+                                   TranslationBlock *tb)
+{
+    CPUJumpCacheEntry *set;
+    unsigned i;
+
+    if (!jc->l2_bits) {
+        return;
+    }
+
+    /*
+     * Prefer an empty way, otherwise replace a pseudo-random one: l2_next
+     * is shared by all the sets, so the way a set gives up depends on the
+     * inserts into the other sets.  That is adequate for a handful of
+     * ways and needs no per-set state.
+     */
+    set = &jc->l2[tb_jmp_cache_hash_func(pc, jc->l2_bits) * jc->l2_ways];
+    for (i = 0; i < jc->l2_ways; i++) {
+        if (qatomic_read(&set[i].tb) == NULL) {
+            break;
+        }
+    }
+    if (i == jc->l2_ways) {
+        i = jc->l2_next++ & (jc->l2_ways - 1);
+    }
+
+    /* Make the entry invalid while pc is being changed. */
+    qatomic_set(&set[i].tb, NULL);
+    set[i].pc = pc;
+    qatomic_set(&set[i].tb, tb);
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
                                           uint64_t cs_base, uint32_t flags,
@@ -242,30 +297,48 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
 {
     TranslationBlock *tb;
     CPUJumpCache *jc;
-    uint32_t hash;
+    CPUJumpCacheEntry *e;
 
     /* we should never be trying to look up an INVALID tb */
     tcg_debug_assert(!(cflags & CF_INVALID));
 
-    hash = tb_jmp_cache_hash_func(pc);
     jc = cpu->tb_jmp_cache;
+    e = &jc->l1->array[tb_jmp_cache_hash_func(pc, jc->l1->bits)];
+    if (unlikely(jc->stats)) {
+        qatomic_set(&jc->lookups, jc->lookups + 1);
+    }
 
-    tb = qatomic_read(&jc->array[hash].tb);
+    tb = qatomic_read(&e->tb);
     if (likely(tb &&
-               jc->array[hash].pc == pc &&
+               e->pc == pc &&
                tb->cs_base == cs_base &&
                tb->flags == flags &&
                tb_cflags(tb) == cflags)) {
         goto hit;
     }
+    if (unlikely(jc->stats)) {
+        qatomic_set(&jc->l1_misses, jc->l1_misses + 1);
+    }
+
+    if (jc->l2_bits) {
+        tb = tb_jmp_cache_l2_lookup(jc, pc, cs_base, flags, cflags);
+        if (tb) {
+            goto fill;
+        }
+        if (unlikely(jc->stats)) {
+            qatomic_set(&jc->l2_misses, jc->l2_misses + 1);
+        }
+    }
 
     tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
     if (tb == NULL) {
         return NULL;
     }
+    tb_jmp_cache_l2_insert(jc, pc, tb);
 
-    jc->array[hash].pc = pc;
-    qatomic_set(&jc->array[hash].tb, tb);
+fill:
+    e->pc = pc;
+    qatomic_set(&e->tb, tb);
 
 hit:
     /*
@@ -984,7 +1057,7 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
             tb = tb_lookup(cpu, pc, cs_base, flags, cflags);
             if (tb == NULL) {
                 CPUJumpCache *jc;
-                uint32_t h;
+                CPUJumpCacheEntry *e;
 
                 mmap_lock();
                 tb = tb_gen_code(cpu, pc, cs_base, flags, cflags);
@@ -994,10 +1067,11 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
                  * We add the TB in the virtual pc hash table
                  * for the fast lookup
                  */
-                h = tb_jmp_cache_hash_func(pc);
                 jc = cpu->tb_jmp_cache;
-                jc->array[h].pc = pc;
-                qatomic_set(&jc->array[h].tb, tb);
+                e = &jc->l1->array[tb_jmp_cache_hash_func(pc, jc->l1->bits)];
+                e->pc = pc;
+                qatomic_set(&e->tb, tb);
+                tb_jmp_cache_l2_insert(jc, pc, tb);
             }
 
 #ifndef CONFIG_USER_ONLY
@@ -1011,6 +1085,17 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
                 last_tb = NULL;
             }
 #endif
+            /*
+             * One-shot TBs are not recorded in their region, so chained
+             * jumps to or from them could not be undone if the region is
+             * evicted, see do_tb_evict().  Without eviction, regions are
+             * only reset all at once and chaining is safe.
+             */
+            if ((tb_page_addr0(tb) == -1 ||
+                 (last_tb && tb_page_addr0(last_tb) == -1)) &&
+                tcg_region_evict_enabled()) {
+                last_tb = NULL;
+            }
             /* See if we can patch the calling TB. */
             if (last_tb) {
                 tb_add_jump(last_tb, tb_exit, tb);
@@ -1036,6 +1121,83 @@ static int cpu_exec_setjmp(CPUState *cpu, SyncClocks *sc)
     return cpu_exec_loop(cpu, sc);
 }
 
+static CPUJumpCacheTable *tb_jmp_cache_table_new(unsigned bits)
+{
+    CPUJumpCacheTable *t;
+
+    t = g_malloc0(sizeof(CPUJumpCacheTable) +
+                  (sizeof(CPUJumpCacheEntry) << bits));
+    t->bits = bits;
+    return t;
+}
+
+/*
+ * With "jmp-cache-adaptive", resize the first level of the jump cache
+ * depending on its miss rate over the last window of lookups, in the
+ * same spirit as tlb_mmu_resize_locked() does for the softmmu TLB.
+ * The window scales with the table so that the cost of rehashing is
+ * amortized over many lookups.
+ *
+ * We grow the table when more than 1 in 8 lookups missed.  We shrink
+ * it when fewer than 1 in 128 lookups missed and less than a quarter of
+ * the entries are in use, so that the two rules cannot fight each other.
+ *
+ * Only the owning CPU may call this.
+ */
+static void tb_jmp_cache_maybe_resize(CPUState *cpu)
+{
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
+    CPUJumpCacheTable *old = jc->l1, *new;
+    size_t size = (size_t)1 << old->bits;
+    size_t lookups = jc->lookups - jc->window_lookups;
+    size_t misses = jc->l1_misses - jc->window_misses;
+    unsigned new_bits = old->bits;
+
+    if (lookups < MAX(size * 16, 1 << 16)) {
+        return;
+    }
+    jc->window_lookups = jc->lookups;
+    jc->window_misses = jc->l1_misses;
+
+    if (misses > lookups / 8) {
+        new_bits = MIN(old->bits + 1, TB_JMP_CACHE_MAX_BITS);
+    } else if (misses < lookups / 128 && old->bits > TB_JMP_CACHE_MIN_BITS) {
+        size_t used = 0;
+
+        for (size_t i = 0; i < size; i++) {
+            used += qatomic_read(&old->array[i].tb) != NULL;
+        }
+        if (used < size / 4) {
+            new_bits = old->bits - 1;
+        }
+    }
+    if (new_bits == old->bits) {
+        return;
+    }
+
+    /*
+     * Carry the live entries over.  Another CPU may invalidate a TB in
+     * the old table after it has been copied; that is harmless because
+     * the TB is already marked CF_INVALID and can never match a lookup.
+     */
+    new = tb_jmp_cache_table_new(new_bits);
+    for (size_t i = 0; i < size; i++) {
+        TranslationBlock *tb = qatomic_read(&old->array[i].tb);
+
+        if (tb) {
+            vaddr pc = old->array[i].pc;
+            CPUJumpCacheEntry *e;
+
+            e = &new->array[tb_jmp_cache_hash_func(pc, new_bits)];
+            e->pc = pc;
+            e->tb = tb;
+        }
+    }
+    qatomic_rcu_set(&jc->l1, new);
+    g_free_rcu(old, rcu);
+    qatomic_set(&jc->resizes, jc->resizes + 1);
+}
+
 int cpu_exec(CPUState *cpu)
 {
     int ret;
@@ -1049,6 +1211,9 @@ int cpu_exec(CPUState *cpu)
     }
 
     RCU_READ_LOCK_GUARD();
+    if (tb_jmp_cache_adaptive) {
+        tb_jmp_cache_maybe_resize(cpu);
+    }
     cpu_exec_enter(cpu);
 
     /*
@@ -1068,13 +1233,23 @@ int cpu_exec(CPUState *cpu)
 bool tcg_exec_realizefn(CPUState *cpu, Error **errp)
 {
     static bool tcg_target_initialized;
+    size_t l2_size;
 
     if (!tcg_target_initialized) {
         cpu->cc->tcg_ops->initialize();
         tcg_target_initialized = true;
     }
 
-    cpu->tb_jmp_cache = g_new0(CPUJumpCache, 1);
+    l2_size = tb_jmp_cache_l2_bits ?
+              tb_jmp_cache_l2_ways << tb_jmp_cache_l2_bits : 0;
+    cpu->tb_jmp_cache = g_malloc0(sizeof(CPUJumpCache) +
+                                  sizeof(CPUJumpCacheEntry) * l2_size);
+    cpu->tb_jmp_cache->l1 = tb_jmp_cache_table_new(tb_jmp_cache_bits);
+    cpu->tb_jmp_cache->stats = tb_jmp_cache_stats || tb_jmp_cache_adaptive;
+    if (l2_size) {
+        cpu->tb_jmp_cache->l2_bits = tb_jmp_cache_l2_bits;
+        cpu->tb_jmp_cache->l2_ways = tb_jmp_cache_l2_ways;
+    }
     tlb_init(cpu);
 #ifndef CONFIG_USER_ONLY
     tcg_iommu_init_notifier_list(cpu);
@@ -1092,5 +1267,6 @@ void tcg_exec_unrealizefn(CPUState *cpu)
 #endif /* !CONFIG_USER_ONLY */
 
     tlb_destroy(cpu);
+    g_free_rcu(cpu->tb_jmp_cache->l1, rcu);
     g_free_rcu(cpu->tb_jmp_cache, rcu);
 }
@@ -105,15 +105,26 @@ static void tlb_window_reset(CPUTLBDesc *desc, int64_t ns,
 static void tb_jmp_cache_clear_page(CPUState *cpu, vaddr page_addr)
 {
     CPUJumpCache *jc = cpu->tb_jmp_cache;
-    int i, i0;
+    CPUJumpCacheTable *l1;
+    int i, i0, n;
 
     if (unlikely(!jc)) {
         return;
     }
 
-    i0 = tb_jmp_cache_hash_page(page_addr);
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
-        qatomic_set(&jc->array[i0 + i].tb, NULL);
+    l1 = jc->l1;
+    i0 = tb_jmp_cache_hash_page(page_addr, l1->bits);
+    n = tb_jmp_cache_page_size(l1->bits);
+    for (i = 0; i < n; i++) {
+        qatomic_set(&l1->array[i0 + i].tb, NULL);
+    }
+
+    if (jc->l2_bits) {
+        n = tb_jmp_cache_page_size(jc->l2_bits) * jc->l2_ways;
+        i0 = tb_jmp_cache_hash_page(page_addr, jc->l2_bits) * jc->l2_ways;
+        for (i = 0; i < n; i++) {
+            qatomic_set(&jc->l2[i0 + i].tb, NULL);
+        }
     }
 }
 
@@ -232,6 +243,11 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
     }
 }
 
+static inline size_t sizeof_vtlb(CPUTLBDesc *desc)
+{
+    return desc->vsets * desc->vways * sizeof(CPUTLBEntry);
+}
+
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
 {
     desc->n_used_entries = 0;
@@ -239,7 +255,12 @@ static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
     desc->large_page_mask = -1;
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
-    memset(desc->vtable, -1, sizeof(desc->vtable));
+    memset(desc->vtable, -1, sizeof_vtlb(desc));
+    desc->lindex = 0;
+    for (int i = 0; i < CPU_LTLB_SIZE; i++) {
+        desc->ltable[i].addr = -1;
+        desc->ltable[i].mask = 0;
+    }
 }
 
 static void tlb_flush_one_mmuidx_locked(CPUState *cpu, int mmu_idx,
@@ -261,6 +282,11 @@ static void tlb_mmu_init(CPUTLBDesc *desc, CPUTLBDescFast *fast, int64_t now)
     fast->mask = (n_entries - 1) << CPU_TLB_ENTRY_BITS;
     fast->table = g_new(CPUTLBEntry, n_entries);
     desc->fulltlb = g_new(CPUTLBEntryFull, n_entries);
+
+    desc->vways = MIN(tlb_victim_ways, tlb_victim_size);
+    desc->vsets = tlb_victim_size / desc->vways;
+    desc->vtable = g_new(CPUTLBEntry, tlb_victim_size);
+    desc->vfulltlb = g_new(CPUTLBEntryFull, tlb_victim_size);
     tlb_mmu_flush_locked(desc, fast);
 }
 
@@ -300,27 +326,13 @@ void tlb_destroy(CPUState *cpu)
 
         g_free(fast->table);
         g_free(desc->fulltlb);
+        g_free(desc->vtable);
+        g_free(desc->vfulltlb);
     }
 }
 
-/* flush_all_helper: run fn across all cpus
- *
- * If the wait flag is set then the src cpu's helper will be queued as
- * "safe" work and the loop exited creating a synchronisation point
- * where all queued work will be finished before execution starts
- * again.
- */
-static void flush_all_helper(CPUState *src, run_on_cpu_func fn,
-                             run_on_cpu_data d)
-{
-    CPUState *cpu;
-
-    CPU_FOREACH(cpu) {
-        if (cpu != src) {
-            async_run_on_cpu(cpu, fn, d);
-        }
-    }
-}
+static void tlb_shootdown_all(CPUState *src, vaddr addr, vaddr len,
+                              uint16_t idxmap, unsigned bits, bool synced);
 
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 {
@@ -385,7 +397,7 @@ void tlb_flush_by_mmuidx_all_cpus(CPUState *src_cpu, uint16_t idxmap)
 
     tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
 
-    flush_all_helper(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    tlb_shootdown_all(src_cpu, 0, 0, idxmap, 0, false);
     fn(src_cpu, RUN_ON_CPU_HOST_INT(idxmap));
 }
 
@@ -396,12 +408,9 @@ void tlb_flush_all_cpus(CPUState *src_cpu)
 
 void tlb_flush_by_mmuidx_all_cpus_synced(CPUState *src_cpu, uint16_t idxmap)
 {
-    const run_on_cpu_func fn = tlb_flush_by_mmuidx_async_work;
-
     tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
 
-    flush_all_helper(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
-    async_safe_run_on_cpu(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    tlb_shootdown_all(src_cpu, 0, 0, idxmap, 0, true);
 }
 
 void tlb_flush_all_cpus_synced(CPUState *src_cpu)
@@ -434,6 +443,23 @@ static inline bool tlb_entry_is_empty(const CPUTLBEntry *te)
     return te->addr_read == -1 && te->addr_write == -1 && te->addr_code == -1;
 }
 
+/**
+ * tlb_entry_page - return the page mapped by a non-empty entry
+ * @te: pointer to CPUTLBEntry
+ */
+static inline vaddr tlb_entry_page(CPUTLBEntry *te)
+{
+    uint64_t addr = te->addr_read;
+
+    if (addr == -1) {
+        addr = tlb_addr_write(te);
+    }
+    if (addr == -1) {
+        addr = te->addr_code;
+    }
+    return addr & TARGET_PAGE_MASK;
+}
+
 /* Called with tlb_c.lock held */
 static bool tlb_flush_entry_mask_locked(CPUTLBEntry *tlb_entry,
                                         vaddr page,
@@ -451,16 +477,37 @@ static inline bool tlb_flush_entry_locked(CPUTLBEntry *tlb_entry, vaddr page)
     return tlb_flush_entry_mask_locked(tlb_entry, page, -1);
 }
 
+/*
+ * Return the index of the first entry of the victim tlb set for @page.
+ * The page number is hashed, so that the entries evicted from a single
+ * slot of the main tlb do not all compete for the same set.
+ */
+static inline size_t tlb_victim_set(CPUTLBDesc *desc, vaddr page)
+{
+    uint64_t h = (page >> TARGET_PAGE_BITS) * 0x9e3779b97f4a7c15ull;
+
+    return ((h >> 32) & (desc->vsets - 1)) * desc->vways;
+}
+
 /* Called with tlb_c.lock held */
 static void tlb_flush_vtlb_page_mask_locked(CPUState *cpu, int mmu_idx,
                                             vaddr page,
                                             vaddr mask)
 {
     CPUTLBDesc *d = &cpu->neg.tlb.d[mmu_idx];
-    int k;
+    size_t k, start, end;
 
     assert_cpu_is_self(cpu);
-    for (k = 0; k < CPU_VTLB_SIZE; k++) {
+
+    /* With a partial mask, matching pages may be in any set.  */
+    if (mask == (vaddr)-1) {
+        start = tlb_victim_set(d, page);
+        end = start + d->vways;
+    } else {
+        start = 0;
+        end = d->vsets * d->vways;
+    }
+    for (k = start; k < end; k++) {
         if (tlb_flush_entry_mask_locked(&d->vtable[k], page, mask)) {
             tlb_n_used_entries_dec(cpu, mmu_idx);
         }
@@ -612,30 +659,8 @@ void tlb_flush_page_by_mmuidx_all_cpus(CPUState *src_cpu, vaddr addr,
     /* This should already be page aligned */
     addr &= TARGET_PAGE_MASK;
 
-    /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
-     */
-    if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-    } else {
-        CPUState *dst_cpu;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                TLBFlushPageByMMUIdxData *d
-                    = g_new(TLBFlushPageByMMUIdxData, 1);
-
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
-    }
-
+    tlb_shootdown_all(src_cpu, addr, TARGET_PAGE_SIZE,
+                      idxmap, TARGET_LONG_BITS, false);
     tlb_flush_page_by_mmuidx_async_0(src_cpu, addr, idxmap);
 }
 
@@ -653,36 +678,8 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
     /* This should already be page aligned */
     addr &= TARGET_PAGE_MASK;
 
-    /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
-     */
-    if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                              RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-    } else {
-        CPUState *dst_cpu;
-        TLBFlushPageByMMUIdxData *d;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                d = g_new(TLBFlushPageByMMUIdxData, 1);
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
-
-        d = g_new(TLBFlushPageByMMUIdxData, 1);
-        d->addr = addr;
-        d->idxmap = idxmap;
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_2,
-                              RUN_ON_CPU_HOST_PTR(d));
-    }
+    tlb_shootdown_all(src_cpu, addr, TARGET_PAGE_SIZE,
+                      idxmap, TARGET_LONG_BITS, true);
 }
 
 void tlb_flush_page_all_cpus_synced(CPUState *src, vaddr addr)
@@ -750,6 +747,7 @@ typedef struct {
 static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
                                               TLBFlushRangeData d)
 {
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
     int mmu_idx;
 
     assert_cpu_is_self(cpu);
@@ -765,11 +763,16 @@ static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
     }
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
 
+    /* During early initialization, the cache may not yet be allocated. */
+    if (unlikely(jc == NULL)) {
+        return;
+    }
+
     /*
      * If the length is larger than the jump cache size, then it will take
      * longer to clear each entry individually than it will to clear it all.
      */
-    if (d.len >= (TARGET_PAGE_SIZE * TB_JMP_CACHE_SIZE)) {
+    if (d.len >= (TARGET_PAGE_SIZE << jc->l1->bits)) {
         tcg_flush_jmp_cache(cpu);
         return;
     }
@@ -793,6 +796,179 @@ static void tlb_flush_range_by_mmuidx_async_1(CPUState *cpu,
     g_free(d);
 }
 
+/*
+ * Cross-cpu flushes are not queued as one work item per request.
+ * Instead they are merged into the CPUTLBShootdown of the destination,
+ * and a single work item performs everything pending when it runs.
+ * Requests for the same mmu_idx that overlap or abut are coalesced into
+ * one range, so a guest invalidating pages one at a time while the
+ * destination is busy costs it one flush of the whole range.  Once
+ * CPU_TLB_SHOOTDOWN_RANGES distinct ranges are pending, the batch
+ * escalates to flushing the affected mmu_idx entirely.
+ *
+ * A request with @bits < TARGET_PAGE_BITS flushes all of @idxmap.
+ */
+static void tlb_shootdown_run(CPUState *cpu, bool safe)
+{
+    CPUTLBShootdown *s = &cpu->neg.tlb.c.shootdown;
+    CPUTLBShootdownRange range[CPU_TLB_SHOOTDOWN_RANGES];
+    uint16_t full_idxmap;
+    unsigned n;
+
+    assert_cpu_is_self(cpu);
+
+    qemu_spin_lock(&cpu->neg.tlb.c.lock);
+    full_idxmap = s->full_idxmap;
+    n = s->n_ranges;
+    memcpy(range, s->range, n * sizeof(range[0]));
+    s->full_idxmap = 0;
+    s->n_ranges = 0;
+    if (safe) {
+        s->queued_safe = false;
+    } else {
+        s->queued = false;
+    }
+    qemu_spin_unlock(&cpu->neg.tlb.c.lock);
+
+    if (full_idxmap) {
+        tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(full_idxmap));
+    }
+    for (unsigned i = 0; i < n; i++) {
+        TLBFlushRangeData d = {
+            .addr = range[i].addr,
+            .len = range[i].len,
+            .idxmap = range[i].idxmap & ~full_idxmap,
+            .bits = range[i].bits,
+        };
+
+        if (d.idxmap == 0) {
+            continue;
+        }
+        if (d.bits >= TARGET_LONG_BITS && d.len <= TARGET_PAGE_SIZE) {
+            tlb_flush_page_by_mmuidx_async_0(cpu, d.addr, d.idxmap);
+        } else {
+            tlb_flush_range_by_mmuidx_async_0(cpu, d);
+        }
+    }
+}
+
+static void tlb_shootdown_async_work(CPUState *cpu, run_on_cpu_data data)
+{
+    tlb_shootdown_run(cpu, false);
+}
+
+static void tlb_shootdown_safe_work(CPUState *cpu, run_on_cpu_data data)
+{
+    tlb_shootdown_run(cpu, true);
+}
+
+/*
+ * Called with tlb_c.lock held.  Return true if the request was merged
+ * into one already pending, rather than adding to the batch.
+ */
+static bool tlb_shootdown_merge_locked(CPUTLBShootdown *s, vaddr addr,
+                                       vaddr len, uint16_t idxmap,
+                                       unsigned bits)
+{
+    if (bits < TARGET_PAGE_BITS) {
+        bool merged = (idxmap & ~s->full_idxmap) == 0;
+
+        s->full_idxmap |= idxmap;
+        return merged;
+    }
+    if ((idxmap & ~s->full_idxmap) == 0) {
+        return true;
+    }
+
+    for (unsigned i = 0; i < s->n_ranges; i++) {
+        CPUTLBShootdownRange *r = &s->range[i];
+
+        if (r->idxmap == idxmap && r->bits == bits &&
+            addr <= r->addr + r->len && r->addr <= addr + len) {
+            vaddr end = MAX(r->addr + r->len, addr + len);
+
+            r->addr = MIN(r->addr, addr);
+            r->len = end - r->addr;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tlb_shootdown_post(CPUState *cpu, vaddr addr, vaddr len,
+                               uint16_t idxmap, unsigned bits, bool safe)
+{
+    CPUTLBCommon *c = &cpu->neg.tlb.c;
+    CPUTLBShootdown *s = &c->shootdown;
+    bool queue;
+
+    qemu_spin_lock(&c->lock);
+
+    if (tlb_shootdown_merge_locked(s, addr, len, idxmap, bits)) {
+        qatomic_set(&c->shootdown_merge_count,
+                    c->shootdown_merge_count + 1);
+    } else if (bits < TARGET_PAGE_BITS) {
+        /* Already recorded in full_idxmap. */
+    } else if (s->n_ranges < CPU_TLB_SHOOTDOWN_RANGES) {
+        CPUTLBShootdownRange *r = &s->range[s->n_ranges++];
+
+        r->addr = addr;
+        r->len = len;
+        r->idxmap = idxmap;
+        r->bits = bits;
+    } else {
+        /* Too many distinct ranges: flush everything they touch. */
+        for (unsigned i = 0; i < s->n_ranges; i++) {
+            s->full_idxmap |= s->range[i].idxmap;
+        }
+        s->full_idxmap |= idxmap;
+        s->n_ranges = 0;
+        qatomic_set(&c->shootdown_escalate_count,
+                    c->shootdown_escalate_count + 1);
+    }
+
+    if (safe) {
+        queue = !s->queued_safe;
+        s->queued_safe = true;
+    } else {
+        queue = !s->queued;
+        s->queued = true;
+    }
+    if (queue) {
+        qatomic_set(&c->shootdown_post_count, c->shootdown_post_count + 1);
+    }
+
+    qemu_spin_unlock(&c->lock);
+
+    /*
+     * A safe work item is queued even when the request was merged into
+     * a plain one, as the caller relies on the synchronisation point.
+     */
+    if (!queue) {
+        return;
+    }
+    if (safe) {
+        async_safe_run_on_cpu(cpu, tlb_shootdown_safe_work, RUN_ON_CPU_NULL);
+    } else {
+        async_run_on_cpu(cpu, tlb_shootdown_async_work, RUN_ON_CPU_NULL);
+    }
+}
+
+static void tlb_shootdown_all(CPUState *src, vaddr addr, vaddr len,
+                              uint16_t idxmap, unsigned bits, bool synced)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        if (cpu != src) {
+            tlb_shootdown_post(cpu, addr, len, idxmap, bits, false);
+        }
+    }
+    if (synced) {
+        tlb_shootdown_post(src, addr, len, idxmap, bits, true);
+    }
+}
+
 void tlb_flush_range_by_mmuidx(CPUState *cpu, vaddr addr,
                                vaddr len, uint16_t idxmap,
                                unsigned bits)
@@ -840,7 +1016,6 @@ void tlb_flush_range_by_mmuidx_all_cpus(CPUState *src_cpu,
                                         uint16_t idxmap, unsigned bits)
 {
     TLBFlushRangeData d;
-    CPUState *dst_cpu;
 
     /*
      * If all bits are significant, and len is small,
@@ -862,16 +1037,7 @@ void tlb_flush_range_by_mmuidx_all_cpus(CPUState *src_cpu,
     d.idxmap = idxmap;
     d.bits = bits;
 
-    /* Allocate a separate data block for each destination cpu.  */
-    CPU_FOREACH(dst_cpu) {
-        if (dst_cpu != src_cpu) {
-            TLBFlushRangeData *p = g_memdup(&d, sizeof(d));
-            async_run_on_cpu(dst_cpu,
-                             tlb_flush_range_by_mmuidx_async_1,
-                             RUN_ON_CPU_HOST_PTR(p));
-        }
-    }
-
+    tlb_shootdown_all(src_cpu, d.addr, len, idxmap, bits, false);
     tlb_flush_range_by_mmuidx_async_0(src_cpu, d);
 }
 
@@ -889,9 +1055,6 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                                uint16_t idxmap,
                                                unsigned bits)
 {
-    TLBFlushRangeData d, *p;
-    CPUState *dst_cpu;
-
     /*
      * If all bits are significant, and len is small,
      * this devolves to tlb_flush_page.
@@ -907,23 +1070,8 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
     }
 
     /* This should already be page aligned */
-    d.addr = addr & TARGET_PAGE_MASK;
-    d.len = len;
-    d.idxmap = idxmap;
-    d.bits = bits;
-
-    /* Allocate a separate data block for each destination cpu.  */
-    CPU_FOREACH(dst_cpu) {
-        if (dst_cpu != src_cpu) {
-            p = g_memdup(&d, sizeof(d));
-            async_run_on_cpu(dst_cpu, tlb_flush_range_by_mmuidx_async_1,
-                             RUN_ON_CPU_HOST_PTR(p));
-        }
-    }
-
-    p = g_memdup(&d, sizeof(d));
-    async_safe_run_on_cpu(src_cpu, tlb_flush_range_by_mmuidx_async_1,
-                          RUN_ON_CPU_HOST_PTR(p));
+    tlb_shootdown_all(src_cpu, addr & TARGET_PAGE_MASK, len,
+                      idxmap, bits, true);
 }
 
 void tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
@@ -1020,7 +1168,8 @@ void tlb_reset_dirty(CPUState *cpu, ram_addr_t start1, ram_addr_t length)
                                          start1, length);
         }
 
-        for (i = 0; i < CPU_VTLB_SIZE; i++) {
+        n = cpu->neg.tlb.d[mmu_idx].vsets * cpu->neg.tlb.d[mmu_idx].vways;
+        for (i = 0; i < n; i++) {
             tlb_reset_dirty_range_locked(&cpu->neg.tlb.d[mmu_idx].vtable[i],
                                          start1, length);
         }
@@ -1052,9 +1201,12 @@ void tlb_set_dirty(CPUState *cpu, vaddr addr)
     }
 
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
-        int k;
-        for (k = 0; k < CPU_VTLB_SIZE; k++) {
-            tlb_set_dirty1_locked(&cpu->neg.tlb.d[mmu_idx].vtable[k], addr);
+        CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+        size_t k = tlb_victim_set(desc, addr);
+        size_t end = k + desc->vways;
+
+        for (; k < end; k++) {
+            tlb_set_dirty1_locked(&desc->vtable[k], addr);
         }
     }
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
@@ -1084,6 +1236,74 @@ static void tlb_add_large_page(CPUState *cpu, int mmu_idx,
     cpu->neg.tlb.d[mmu_idx].large_page_mask = lp_mask;
 }
 
+/*
+ * Remember a translation covering more than one page, so that
+ * tlb_fill_large can enter the other pages of the region into
+ * the TLB without calling back into the target.  The region is
+ * never larger than the one recorded by tlb_add_large_page, so
+ * any flush that could invalidate it flushes the entire tlb.
+ */
+static void tlb_add_large_entry(CPUState *cpu, int mmu_idx,
+                                vaddr addr, CPUTLBEntryFull *full)
+{
+    CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+    int lg_size = MIN(full->lg_map_size, full->lg_page_size);
+    vaddr mask = -((vaddr)1 << lg_size);
+    CPUTLBLargeEntry *le = NULL;
+
+    /* Pages which must be refilled on every write are not cached. */
+    if (full->prot & PAGE_WRITE_INV) {
+        return;
+    }
+
+    for (int i = 0; i < CPU_LTLB_SIZE; i++) {
+        if (desc->ltable[i].addr == (addr & mask) &&
+            desc->ltable[i].mask == mask) {
+            le = &desc->ltable[i];
+            break;
+        }
+    }
+    if (le == NULL) {
+        le = &desc->ltable[desc->lindex++ % CPU_LTLB_SIZE];
+    }
+
+    le->addr = addr & mask;
+    le->mask = mask;
+    le->full = *full;
+    le->full.phys_addr = (full->phys_addr & TARGET_PAGE_MASK)
+                         - (addr & ~mask & TARGET_PAGE_MASK);
+}
+
+/*
+ * Fill the TLB for @addr from the large page table, if it contains a
+ * translation for @addr that permits @access_type.  Return false if
+ * the caller must use the target's tlb_fill hook instead.
+ */
+static bool tlb_fill_large(CPUState *cpu, vaddr addr,
+                           MMUAccessType access_type, int mmu_idx)
+{
+    CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+    int need = (access_type == MMU_DATA_STORE ? PAGE_WRITE :
+                access_type == MMU_INST_FETCH ? PAGE_EXEC : PAGE_READ);
+
+    for (int i = 0; i < CPU_LTLB_SIZE; i++) {
+        CPUTLBLargeEntry *le = &desc->ltable[i];
+
+        if ((addr & le->mask) == le->addr && (le->full.prot & need)) {
+            CPUTLBEntryFull full = le->full;
+
+            full.phys_addr += addr & ~le->mask & TARGET_PAGE_MASK;
+            /* Already recorded; do not replace the entry again. */
+            full.lg_map_size = 0;
+            tlb_set_page_full(cpu, mmu_idx, addr & TARGET_PAGE_MASK, &full);
+            qatomic_set(&cpu->neg.tlb.c.large_fill_count,
+                        cpu->neg.tlb.c.large_fill_count + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
 static inline void tlb_set_compare(CPUTLBEntryFull *full, CPUTLBEntry *ent,
                                    vaddr address, int flags,
                                    MMUAccessType access_type, bool enable)
@@ -1131,6 +1351,9 @@ void tlb_set_page_full(CPUState *cpu, int mmu_idx,
     } else {
         sz = (hwaddr)1 << full->lg_page_size;
         tlb_add_large_page(cpu, mmu_idx, addr, sz);
+        if (full->lg_map_size > TARGET_PAGE_BITS) {
+            tlb_add_large_entry(cpu, mmu_idx, addr, full);
+        }
     }
     addr_page = addr & TARGET_PAGE_MASK;
     paddr_page = full->phys_addr & TARGET_PAGE_MASK;
@@ -1217,7 +1440,8 @@ void tlb_set_page_full(CPUState *cpu, int mmu_idx,
      * different page; otherwise just overwrite the stale data.
      */
     if (!tlb_hit_page_anyprot(te, addr_page) && !tlb_entry_is_empty(te)) {
-        unsigned vidx = desc->vindex++ % CPU_VTLB_SIZE;
+        size_t vidx = tlb_victim_set(desc, tlb_entry_page(te))
+                      + desc->vindex++ % desc->vways;
         CPUTLBEntry *tv = &desc->vtable[vidx];
 
         /* Evict the old entry into the victim tlb.  */
@@ -1305,6 +1529,10 @@ static void tlb_fill(CPUState *cpu, vaddr addr, int size,
 {
     bool ok;
 
+    if (tlb_fill_large(cpu, addr, access_type, mmu_idx)) {
+        return;
+    }
+
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
@@ -1359,30 +1587,53 @@ static void io_failed(CPUState *cpu, CPUTLBEntryFull *full, vaddr addr,
 static bool victim_tlb_hit(CPUState *cpu, size_t mmu_idx, size_t index,
                            MMUAccessType access_type, vaddr page)
 {
+    CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+    size_t set = tlb_victim_set(desc, page);
     size_t vidx;
 
     assert_cpu_is_self(cpu);
-    for (vidx = 0; vidx < CPU_VTLB_SIZE; ++vidx) {
-        CPUTLBEntry *vtlb = &cpu->neg.tlb.d[mmu_idx].vtable[vidx];
+    for (vidx = set; vidx < set + desc->vways; ++vidx) {
+        CPUTLBEntry *vtlb = &desc->vtable[vidx];
         uint64_t cmp = tlb_read_idx(vtlb, access_type);
 
         if (cmp == page) {
             /* Found entry in victim tlb, swap tlb and iotlb.  */
             CPUTLBEntry tmptlb, *tlb = &cpu->neg.tlb.f[mmu_idx].table[index];
+            size_t slot = vidx;
 
             qemu_spin_lock(&cpu->neg.tlb.c.lock);
             copy_tlb_helper_locked(&tmptlb, tlb);
             copy_tlb_helper_locked(tlb, vtlb);
-            copy_tlb_helper_locked(vtlb, &tmptlb);
+            /*
+             * Entries must live in the set of their own page, where
+             * lookups and flushes search for them: the entry displaced
+             * from the main tlb may belong to a different set.
+             */
+            if (desc->vsets > 1 && !tlb_entry_is_empty(&tmptlb)) {
+                size_t other = tlb_victim_set(desc, tlb_entry_page(&tmptlb));
+
+                if (other != set) {
+                    memset(vtlb, -1, sizeof(*vtlb));
+                    slot = other + desc->vindex++ % desc->vways;
+                }
+            }
+            copy_tlb_helper_locked(&desc->vtable[slot], &tmptlb);
+            /* Account for the move as tlb_set_page_full() does. */
+            if (!tlb_entry_is_empty(&tmptlb)) {
+                tlb_n_used_entries_dec(cpu, mmu_idx);
+            }
+            tlb_n_used_entries_inc(cpu, mmu_idx);
             qemu_spin_unlock(&cpu->neg.tlb.c.lock);
 
-            CPUTLBEntryFull *f1 = &cpu->neg.tlb.d[mmu_idx].fulltlb[index];
-            CPUTLBEntryFull *f2 = &cpu->neg.tlb.d[mmu_idx].vfulltlb[vidx];
-            CPUTLBEntryFull tmpf;
-            tmpf = *f1; *f1 = *f2; *f2 = tmpf;
+            CPUTLBEntryFull *f1 = &desc->fulltlb[index];
+            CPUTLBEntryFull tmpf = *f1;
+            *f1 = desc->vfulltlb[vidx];
+            desc->vfulltlb[slot] = tmpf;
+            qatomic_set(&desc->vtlb_hits, desc->vtlb_hits + 1);
             return true;
         }
     }
+    qatomic_set(&desc->vtlb_misses, desc->vtlb_misses + 1);
     return false;
 }
 
@@ -1426,7 +1677,8 @@ static int probe_access_internal(CPUState *cpu, vaddr addr,
 
     if (!tlb_hit_page(tlb_addr, page_addr)) {
         if (!victim_tlb_hit(cpu, mmu_idx, index, access_type, page_addr)) {
-            if (!cpu->cc->tcg_ops->tlb_fill(cpu, addr, fault_size, access_type,
+            if (!tlb_fill_large(cpu, addr, access_type, mmu_idx) &&
+                !cpu->cc->tcg_ops->tlb_fill(cpu, addr, fault_size, access_type,
                                             mmu_idx, nonfault, retaddr)) {
                 /* Non-faulting page table read failed.  */
                 *phost = NULL;
@@ -2382,6 +2634,46 @@ static uint64_t do_ld_8(CPUState *cpu, MMULookupPageData *p, int mmu_idx,
     return ret;
 }
 
+/**
+ * mmu_crosspage_is_ram
+ * @l: results of a page-crossing mmu_lookup
+ *
+ * Return true if the access described by @l may be performed with plain
+ * host memory operations on both pages: neither page is MMIO nor discards
+ * writes, and, given that we cross a page, the access has no atomicity
+ * requirement beyond single bytes.  Watchpoints and dirty tracking have
+ * already been handled by mmu_lookup.
+ */
+static bool mmu_crosspage_is_ram(MMULookupLocals *l)
+{
+    int flags = l->page[0].flags | l->page[1].flags;
+
+    switch (l->memop & MO_ATOM_MASK) {
+    case MO_ATOM_IFALIGN:
+    case MO_ATOM_WITHIN16:
+    case MO_ATOM_NONE:
+        return !(flags & (TLB_MMIO | TLB_DISCARD_WRITE));
+    default:
+        return false;
+    }
+}
+
+/*
+ * Copy the two parts of a page-crossing access between RAM and @buf,
+ * which holds the value in host byte order.
+ */
+static void do_ld_crosspage_ram(MMULookupLocals *l, void *buf)
+{
+    memcpy(buf, l->page[0].haddr, l->page[0].size);
+    memcpy(buf + l->page[0].size, l->page[1].haddr, l->page[1].size);
+}
+
+static void do_st_crosspage_ram(MMULookupLocals *l, const void *buf)
+{
+    memcpy(l->page[0].haddr, buf, l->page[0].size);
+    memcpy(l->page[1].haddr, buf + l->page[0].size, l->page[1].size);
+}
+
 static uint8_t do_ld1_mmu(CPUState *cpu, vaddr addr, MemOpIdx oi,
                           uintptr_t ra, MMUAccessType access_type)
 {
@@ -2433,6 +2725,14 @@ static uint32_t do_ld4_mmu(CPUState *cpu, vaddr addr, MemOpIdx oi,
         return do_ld_4(cpu, &l.page[0], l.mmu_idx, access_type, l.memop, ra);
     }
 
+    if (likely(mmu_crosspage_is_ram(&l))) {
+        do_ld_crosspage_ram(&l, &ret);
+        if (l.memop & MO_BSWAP) {
+            ret = bswap32(ret);
+        }
+        return ret;
+    }
+
     ret = do_ld_beN(cpu, &l.page[0], 0, l.mmu_idx, access_type, l.memop, ra);
     ret = do_ld_beN(cpu, &l.page[1], ret, l.mmu_idx, access_type, l.memop, ra);
     if ((l.memop & MO_BSWAP) == MO_LE) {
@@ -2454,6 +2754,14 @@ static uint64_t do_ld8_mmu(CPUState *cpu, vaddr addr, MemOpIdx oi,
         return do_ld_8(cpu, &l.page[0], l.mmu_idx, access_type, l.memop, ra);
     }
 
+    if (likely(mmu_crosspage_is_ram(&l))) {
+        do_ld_crosspage_ram(&l, &ret);
+        if (l.memop & MO_BSWAP) {
+            ret = bswap64(ret);
+        }
+        return ret;
+    }
+
     ret = do_ld_beN(cpu, &l.page[0], 0, l.mmu_idx, access_type, l.memop, ra);
     ret = do_ld_beN(cpu, &l.page[1], ret, l.mmu_idx, access_type, l.memop, ra);
     if ((l.memop & MO_BSWAP) == MO_LE) {
@@ -2842,6 +3150,14 @@ static void do_st4_mmu(CPUState *cpu, vaddr addr, uint32_t val,
         return;
     }
 
+    if (likely(mmu_crosspage_is_ram(&l))) {
+        if (l.memop & MO_BSWAP) {
+            val = bswap32(val);
+        }
+        do_st_crosspage_ram(&l, &val);
+        return;
+    }
+
     /* Swap to little endian for simplicity, then store by bytes. */
     if ((l.memop & MO_BSWAP) != MO_LE) {
         val = bswap32(val);
@@ -2863,6 +3179,14 @@ static void do_st8_mmu(CPUState *cpu, vaddr addr, uint64_t val,
         return;
     }
 
+    if (likely(mmu_crosspage_is_ram(&l))) {
+        if (l.memop & MO_BSWAP) {
+            val = bswap64(val);
+        }
+        do_st_crosspage_ram(&l, &val);
+        return;
+    }
+
     /* Swap to little endian for simplicity, then store by bytes. */
     if ((l.memop & MO_BSWAP) != MO_LE) {
         val = bswap64(val);
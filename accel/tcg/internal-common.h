@@ -14,6 +14,16 @@
 extern int64_t max_delay;
 extern int64_t max_advance;
 
+/* Register the "tcg" provider of the query-stats QMP command. */
+void tcg_stats_init(void);
+
+/* Sampling profiler of translated code, see tcg-profile.c. */
+bool tcg_profile_supported(void);
+void tcg_profile_init(unsigned period_us, unsigned max_cpus);
+void tcg_profile_thread_start(void);
+void tcg_profile_thread_stop(void);
+void tcg_profile_dump(GString *buf);
+
 /*
  * Return true if CS is not running in parallel with other cpus, either
  * because there are no other cpus or we are within an exclusive context.
@@ -74,6 +74,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu, vaddr pc,
                               int cflags);
 void page_init(void);
 void tb_htable_init(void);
+void tb_evict(CPUState *cpu);
 void tb_reset_jump(TranslationBlock *tb, int n);
 TranslationBlock *tb_link_page(TranslationBlock *tb);
 bool tb_invalidate_phys_page_unwind(tb_page_addr_t addr, uintptr_t pc);
@@ -94,6 +95,15 @@ static inline vaddr log_pc(CPUState *cpu, const TranslationBlock *tb)
 }
 
 extern bool one_insn_per_tb;
+extern unsigned tb_jmp_cache_bits;
+extern bool tb_jmp_cache_adaptive;
+extern bool tb_jmp_cache_stats;
+extern unsigned tb_jmp_cache_l2_bits;
+extern unsigned tb_jmp_cache_l2_ways;
+#ifndef CONFIG_USER_ONLY
+extern unsigned tlb_victim_size;
+extern unsigned tlb_victim_ways;
+#endif
 
 /**
  * tcg_req_mo:
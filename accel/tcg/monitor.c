@@ -9,6 +9,7 @@
 #include "qemu/osdep.h"
 #include "qemu/accel.h"
 #include "qemu/qht.h"
+#include "qemu/timer.h"
 #include "qapi/error.h"
 #include "qapi/type-helpers.h"
 #include "qapi/qapi-commands-machine.h"
@@ -16,9 +17,11 @@
 #include "sysemu/cpus.h"
 #include "sysemu/cpu-timers.h"
 #include "sysemu/tcg.h"
+#include "sysemu/stats.h"
 #include "tcg/tcg.h"
 #include "internal-common.h"
 #include "tb-context.h"
+#include "tb-jmp-cache.h"
 
 
 static void dump_drift_info(GString *buf)
@@ -141,6 +144,76 @@ static void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+static void tlb_shootdown_counts(size_t *ppost, size_t *pmerge,
+                                 size_t *pescalate)
+{
+    CPUState *cpu;
+    size_t post = 0, merge = 0, escalate = 0;
+
+    CPU_FOREACH(cpu) {
+        post += qatomic_read(&cpu->neg.tlb.c.shootdown_post_count);
+        merge += qatomic_read(&cpu->neg.tlb.c.shootdown_merge_count);
+        escalate += qatomic_read(&cpu->neg.tlb.c.shootdown_escalate_count);
+    }
+    *ppost = post;
+    *pmerge = merge;
+    *pescalate = escalate;
+}
+
+static void tlb_victim_counts(size_t *hits, size_t *misses)
+{
+    CPUState *cpu;
+
+    memset(hits, 0, NB_MMU_MODES * sizeof(size_t));
+    memset(misses, 0, NB_MMU_MODES * sizeof(size_t));
+    CPU_FOREACH(cpu) {
+        for (int i = 0; i < NB_MMU_MODES; i++) {
+            hits[i] += qatomic_read(&cpu->neg.tlb.d[i].vtlb_hits);
+            misses[i] += qatomic_read(&cpu->neg.tlb.d[i].vtlb_misses);
+        }
+    }
+}
+
+static size_t tlb_large_fill_count(void)
+{
+    CPUState *cpu;
+    size_t fills = 0;
+
+    CPU_FOREACH(cpu) {
+        fills += qatomic_read(&cpu->neg.tlb.c.large_fill_count);
+    }
+    return fills;
+}
+
+/*
+ * Without a second level, every first level miss goes to the hash table.
+ * Returns false if no vCPU keeps jump cache statistics.
+ */
+static bool tb_lookup_counts(size_t *plookups, size_t *pl1_miss,
+                             size_t *pl2_miss)
+{
+    CPUState *cpu;
+    size_t lookups = 0, l1_miss = 0, l2_miss = 0;
+    bool stats = false;
+
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = cpu->tb_jmp_cache;
+
+        if (jc && jc->stats) {
+            size_t miss = qatomic_read(&jc->l1_misses);
+
+            lookups += qatomic_read(&jc->lookups);
+            l1_miss += miss;
+            l2_miss += jc->l2_bits ? qatomic_read(&jc->l2_misses) : miss;
+            stats = true;
+        }
+    }
+    *plookups = lookups;
+    *pl1_miss = l1_miss;
+    *pl2_miss = l2_miss;
+    return stats;
+}
+
 static void tcg_dump_info(GString *buf)
 {
     g_string_append_printf(buf, "[TCG profiler not compiled]\n");
@@ -151,6 +224,9 @@ static void dump_exec_info(GString *buf)
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
     size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t lookups, l1_miss, l2_miss;
+    size_t sd_post, sd_merge, sd_escalate;
+    size_t vtlb_hits[NB_MMU_MODES], vtlb_misses[NB_MMU_MODES];
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -189,13 +265,62 @@ static void dump_exec_info(GString *buf)
     g_string_append_printf(buf, "\nStatistics:\n");
     g_string_append_printf(buf, "TB flush count      %u\n",
                            qatomic_read(&tb_ctx.tb_flush_count));
+    g_string_append_printf(buf, "TB flush time       %" PRIu64 " us "
+                           "(max %" PRIu64 " us)\n",
+                           qatomic_read_u64(&tb_ctx.tb_flush_time) / SCALE_US,
+                           qatomic_read_u64(&tb_ctx.tb_flush_time_max) /
+                           SCALE_US);
+    g_string_append_printf(buf, "TB region evictions %u (%u TBs)\n",
+                           qatomic_read(&tb_ctx.tb_evict_count),
+                           qatomic_read(&tb_ctx.tb_evicted_count));
+    g_string_append_printf(buf, "TB eviction time    %" PRIu64 " us "
+                           "(max %" PRIu64 " us)\n",
+                           qatomic_read_u64(&tb_ctx.tb_evict_time) / SCALE_US,
+                           qatomic_read_u64(&tb_ctx.tb_evict_time_max) /
+                           SCALE_US);
     g_string_append_printf(buf, "TB invalidate count %u\n",
                            qatomic_read(&tb_ctx.tb_phys_invalidate_count));
 
+    if (tb_lookup_counts(&lookups, &l1_miss, &l2_miss)) {
+        g_string_append_printf(buf, "TB lookups          %zu\n", lookups);
+        g_string_append_printf(buf, "TB jmp cache hits   %zu (%0.2f%%)\n",
+                               lookups - l1_miss,
+                               lookups ? (double)(lookups - l1_miss) /
+                               lookups * 100 : 0);
+        g_string_append_printf(buf,
+                               "TB jmp L2 hits      %zu (%0.2f%% of misses)\n",
+                               l1_miss - l2_miss,
+                               l1_miss ? (double)(l1_miss - l2_miss) /
+                               l1_miss * 100 : 0);
+        g_string_append_printf(buf, "TB hash lookups     %zu\n", l2_miss);
+    } else {
+        g_string_append_printf(buf, "TB lookups          "
+                               "(not counted, see jmp-cache-stats)\n");
+    }
+
     tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
     g_string_append_printf(buf, "TLB full flushes    %zu\n", flush_full);
     g_string_append_printf(buf, "TLB partial flushes %zu\n", flush_part);
     g_string_append_printf(buf, "TLB elided flushes  %zu\n", flush_elide);
+    g_string_append_printf(buf, "TLB large fills     %zu\n",
+                           tlb_large_fill_count());
+
+    tlb_shootdown_counts(&sd_post, &sd_merge, &sd_escalate);
+    g_string_append_printf(buf, "TLB shootdown posts %zu\n", sd_post);
+    g_string_append_printf(buf, "TLB merged posts    %zu\n", sd_merge);
+    g_string_append_printf(buf, "TLB escalated posts %zu\n", sd_escalate);
+
+    tlb_victim_counts(vtlb_hits, vtlb_misses);
+    for (int i = 0; i < NB_MMU_MODES; i++) {
+        size_t lookups = vtlb_hits[i] + vtlb_misses[i];
+
+        if (lookups) {
+            g_string_append_printf(buf, "TLB victim mmu_idx %-2d %zu hits, "
+                                   "%zu misses (%0.2f%% hit)\n",
+                                   i, vtlb_hits[i], vtlb_misses[i],
+                                   (double)vtlb_hits[i] / lookups * 100);
+        }
+    }
     tcg_dump_info(buf);
 }
 
@@ -217,7 +342,11 @@ HumanReadableText *qmp_x_query_jit(Error **errp)
 
 static void tcg_dump_op_count(GString *buf)
 {
-    g_string_append_printf(buf, "[TCG profiler not compiled]\n");
+    size_t cse, ld;
+
+    tcg_optimize_counts(&cse, &ld);
+    g_string_append_printf(buf, "CSE eliminated ops  %zu\n", cse);
+    g_string_append_printf(buf, "CSE eliminated lds  %zu\n", ld);
 }
 
 HumanReadableText *qmp_x_query_opcount(Error **errp)
@@ -235,10 +364,164 @@ HumanReadableText *qmp_x_query_opcount(Error **errp)
     return human_readable_text_from_str(buf);
 }
 
+HumanReadableText *qmp_x_query_tcg_profile(Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+
+    if (!tcg_enabled()) {
+        error_setg(errp,
+                   "TCG profile information is only available with accel=tcg");
+        return NULL;
+    }
+
+    tcg_profile_dump(buf);
+
+    return human_readable_text_from_str(buf);
+}
+
+static StatsList *tcg_stats_add(StatsList *stats_list, strList *names,
+                                const char *name, uint64_t val)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return stats_list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = val;
+
+    QAPI_LIST_PREPEND(stats_list, stats);
+    return stats_list;
+}
+
+static StatsList *tcg_stats_add_list(StatsList *stats_list, strList *names,
+                                     const char *name, const uint64_t *val,
+                                     int n)
+{
+    uint64List *val_list = NULL;
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return stats_list;
+    }
+
+    while (n-- > 0) {
+        QAPI_LIST_PREPEND(val_list, val[n]);
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QLIST;
+    stats->value->u.list = val_list;
+
+    QAPI_LIST_PREPEND(stats_list, stats);
+    return stats_list;
+}
+
+static void tcg_query_stats_cb(StatsResultList **result, StatsTarget target,
+                               strList *names, strList *targets, Error **errp)
+{
+    CPUState *cpu;
+
+    if (target != STATS_TARGET_VCPU) {
+        return;
+    }
+
+    RCU_READ_LOCK_GUARD();
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = cpu->tb_jmp_cache;
+        StatsList *stats_list = NULL;
+        uint64_t vtlb_hits[NB_MMU_MODES], vtlb_misses[NB_MMU_MODES];
+        size_t lookups, l1_miss;
+
+        if (!jc ||
+            !apply_str_list_filter(cpu->parent_obj.canonical_path, targets)) {
+            continue;
+        }
+
+        if (jc->stats) {
+            lookups = qatomic_read(&jc->lookups);
+            l1_miss = qatomic_read(&jc->l1_misses);
+            stats_list = tcg_stats_add(stats_list, names, "jmp-cache-hits",
+                                       lookups - l1_miss);
+            stats_list = tcg_stats_add(stats_list, names, "jmp-cache-misses",
+                                       l1_miss);
+            if (jc->l2_bits) {
+                stats_list = tcg_stats_add(stats_list, names,
+                                           "jmp-cache-l2-misses",
+                                           qatomic_read(&jc->l2_misses));
+            }
+        }
+        stats_list = tcg_stats_add(stats_list, names, "jmp-cache-resizes",
+                                   qatomic_read(&jc->resizes));
+        stats_list = tcg_stats_add(stats_list, names, "jmp-cache-entries",
+                                   1ull << qatomic_rcu_read(&jc->l1)->bits);
+
+        for (int i = 0; i < NB_MMU_MODES; i++) {
+            vtlb_hits[i] = qatomic_read(&cpu->neg.tlb.d[i].vtlb_hits);
+            vtlb_misses[i] = qatomic_read(&cpu->neg.tlb.d[i].vtlb_misses);
+        }
+        stats_list = tcg_stats_add_list(stats_list, names, "victim-tlb-hits",
+                                        vtlb_hits, NB_MMU_MODES);
+        stats_list = tcg_stats_add_list(stats_list, names, "victim-tlb-misses",
+                                        vtlb_misses, NB_MMU_MODES);
+        add_stats_entry(result, STATS_PROVIDER_TCG,
+                        cpu->parent_obj.canonical_path, stats_list);
+    }
+}
+
+static StatsSchemaValueList *tcg_schemas_add(StatsSchemaValueList *list,
+                                             const char *name, StatsType type)
+{
+    StatsSchemaValueList *schema_entry = g_new0(StatsSchemaValueList, 1);
+
+    schema_entry->value = g_new0(StatsSchemaValue, 1);
+    schema_entry->value->type = type;
+    schema_entry->value->name = g_strdup(name);
+    schema_entry->next = list;
+
+    return schema_entry;
+}
+
+static void tcg_query_stats_schemas_cb(StatsSchemaList **result,
+                                       Error **errp)
+{
+    StatsSchemaValueList *stats_list = NULL;
+
+    stats_list = tcg_schemas_add(stats_list, "jmp-cache-hits",
+                                 STATS_TYPE_CUMULATIVE);
+    stats_list = tcg_schemas_add(stats_list, "jmp-cache-misses",
+                                 STATS_TYPE_CUMULATIVE);
+    stats_list = tcg_schemas_add(stats_list, "jmp-cache-l2-misses",
+                                 STATS_TYPE_CUMULATIVE);
+    stats_list = tcg_schemas_add(stats_list, "jmp-cache-resizes",
+                                 STATS_TYPE_CUMULATIVE);
+    stats_list = tcg_schemas_add(stats_list, "jmp-cache-entries",
+                                 STATS_TYPE_INSTANT);
+    stats_list = tcg_schemas_add(stats_list, "victim-tlb-hits",
+                                 STATS_TYPE_CUMULATIVE);
+    stats_list = tcg_schemas_add(stats_list, "victim-tlb-misses",
+                                 STATS_TYPE_CUMULATIVE);
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VCPU,
+                     stats_list);
+}
+
+void tcg_stats_init(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_TCG, tcg_query_stats_cb,
+                        tcg_query_stats_schemas_cb);
+}
+
 static void hmp_tcg_register(void)
 {
     monitor_register_hmp_info_hrt("jit", qmp_x_query_jit);
     monitor_register_hmp_info_hrt("opcount", qmp_x_query_opcount);
+    monitor_register_hmp_info_hrt("tcg-profile", qmp_x_query_tcg_profile);
 }
 
 type_init(hmp_tcg_register);
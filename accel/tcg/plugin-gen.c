@@ -82,7 +82,9 @@ enum plugin_gen_cb {
     PLUGIN_GEN_CB_UDATA,
     PLUGIN_GEN_CB_UDATA_R,
     PLUGIN_GEN_CB_INLINE,
+    PLUGIN_GEN_CB_COND,
     PLUGIN_GEN_CB_MEM,
+    PLUGIN_GEN_CB_MEM_BUFFER,
     PLUGIN_GEN_ENABLE_MEM_HELPER,
     PLUGIN_GEN_DISABLE_MEM_HELPER,
     PLUGIN_GEN_N_CBS,
@@ -103,6 +105,11 @@ void HELPER(plugin_vcpu_mem_cb)(unsigned int vcpu_index,
                                 void *userdata)
 { }
 
+void HELPER(plugin_vcpu_mem_buffer_flush)(uint32_t cpu_index, void *buf)
+{
+    qemu_plugin_mem_buffer_flush_vcpu(buf, cpu_index);
+}
+
 static void gen_empty_udata_cb(void (*gen_helper)(TCGv_i32, TCGv_ptr))
 {
     TCGv_i32 cpu_index = tcg_temp_ebb_new_i32();
@@ -157,6 +164,45 @@ static void gen_empty_inline_cb(void)
     tcg_temp_free_i32(cpu_index);
 }
 
+/*
+ * Call the udata callback if the scoreboard entry compares true with
+ * an immediate.  The condition, the immediate and the label are all
+ * replaced when the template is copied.
+ */
+static void gen_empty_cond_cb(void)
+{
+    TCGv_i32 cpu_index = tcg_temp_ebb_new_i32();
+    TCGv_i32 cpu_offset = tcg_temp_ebb_new_i32();
+    TCGv_ptr cpu_offset_as_ptr = tcg_temp_ebb_new_ptr();
+    TCGv_i64 val = tcg_temp_ebb_new_i64();
+    TCGv_ptr ptr = tcg_temp_ebb_new_ptr();
+    TCGv_ptr udata = tcg_temp_ebb_new_ptr();
+    TCGLabel *after_cb = gen_new_label();
+
+    tcg_gen_ld_i32(cpu_index, tcg_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    /* second operand will be replaced by immediate value */
+    tcg_gen_mul_i32(cpu_offset, cpu_index, cpu_index);
+    tcg_gen_ext_i32_ptr(cpu_offset_as_ptr, cpu_offset);
+
+    tcg_gen_movi_ptr(ptr, 0);
+    tcg_gen_add_ptr(ptr, ptr, cpu_offset_as_ptr);
+    tcg_gen_ld_i64(val, ptr, 0);
+    /* second operand and condition will be replaced by immediate values */
+    tcg_gen_brcond_i64(TCG_COND_EQ, val, val, after_cb);
+
+    tcg_gen_movi_ptr(udata, 0);
+    gen_helper_plugin_vcpu_udata_cb_no_wg(cpu_index, udata);
+    gen_set_label(after_cb);
+
+    tcg_temp_free_ptr(udata);
+    tcg_temp_free_ptr(ptr);
+    tcg_temp_free_i64(val);
+    tcg_temp_free_ptr(cpu_offset_as_ptr);
+    tcg_temp_free_i32(cpu_offset);
+    tcg_temp_free_i32(cpu_index);
+}
+
 static void gen_empty_mem_cb(TCGv_i64 addr, uint32_t info)
 {
     TCGv_i32 cpu_index = tcg_temp_ebb_new_i32();
@@ -175,6 +221,92 @@ static void gen_empty_mem_cb(TCGv_i64 addr, uint32_t info)
     tcg_temp_free_i32(cpu_index);
 }
 
+/*
+ * Append a qemu_plugin_mem_record to the buffer of the current vcpu.
+ * There is no room check here: we are in the middle of the guest
+ * instruction, and a branch would end the live range of its EBB temps.
+ * Instead, gen_empty_mem_buffer_check() makes room for all the records
+ * of an instruction before it starts.
+ */
+static void gen_empty_mem_buffer_cb(TCGv_i64 addr, uint32_t info)
+{
+    TCGv_i32 cpu_index = tcg_temp_ebb_new_i32();
+    TCGv_ptr cpu_index_as_ptr = tcg_temp_ebb_new_ptr();
+    TCGv_ptr ptr = tcg_temp_ebb_new_ptr();
+    TCGv_ptr used = tcg_temp_ebb_new_ptr();
+    TCGv_ptr rec = tcg_temp_ebb_new_ptr();
+    size_t rec_base = offsetof(struct qemu_plugin_mem_buffer_vcpu, records);
+
+    tcg_gen_ld_i32(cpu_index, tcg_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    /* second operand will be replaced by immediate value */
+    tcg_gen_mul_i32(cpu_index, cpu_index, cpu_index);
+    tcg_gen_ext_i32_ptr(cpu_index_as_ptr, cpu_index);
+
+    tcg_gen_movi_ptr(ptr, 0);
+    tcg_gen_add_ptr(ptr, ptr, cpu_index_as_ptr);
+    tcg_gen_ld_ptr(used, ptr,
+                   offsetof(struct qemu_plugin_mem_buffer_vcpu, used));
+    tcg_gen_add_ptr(rec, ptr, used);
+
+    tcg_gen_st_i64(addr, rec,
+                   rec_base + offsetof(struct qemu_plugin_mem_record, vaddr));
+    /* stored value will be replaced by the instruction address */
+    tcg_gen_st_i64(tcg_constant_i64(0), rec,
+                   rec_base + offsetof(struct qemu_plugin_mem_record, pc));
+    tcg_gen_st_i32(tcg_constant_i32(info), rec,
+                   rec_base + offsetof(struct qemu_plugin_mem_record, info));
+
+    tcg_gen_addi_ptr(used, used, sizeof(struct qemu_plugin_mem_record));
+    tcg_gen_st_ptr(used, ptr,
+                   offsetof(struct qemu_plugin_mem_buffer_vcpu, used));
+
+    tcg_temp_free_ptr(rec);
+    tcg_temp_free_ptr(used);
+    tcg_temp_free_ptr(ptr);
+    tcg_temp_free_ptr(cpu_index_as_ptr);
+    tcg_temp_free_i32(cpu_index);
+}
+
+/*
+ * Flush the buffer of the current vcpu unless it has room for all the
+ * records of the instruction. The limit, the buffer and the label are
+ * replaced when the template is copied.
+ */
+static void gen_empty_mem_buffer_check(void)
+{
+    TCGv_i32 cpu_index = tcg_temp_ebb_new_i32();
+    TCGv_i32 cpu_offset = tcg_temp_ebb_new_i32();
+    TCGv_ptr cpu_offset_as_ptr = tcg_temp_ebb_new_ptr();
+    TCGv_ptr ptr = tcg_temp_ebb_new_ptr();
+    TCGv_ptr used = tcg_temp_ebb_new_ptr();
+    TCGv_ptr buf = tcg_temp_ebb_new_ptr();
+    TCGLabel *after_flush = gen_new_label();
+
+    tcg_gen_ld_i32(cpu_index, tcg_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    /* second operand will be replaced by immediate value */
+    tcg_gen_mul_i32(cpu_offset, cpu_index, cpu_index);
+    tcg_gen_ext_i32_ptr(cpu_offset_as_ptr, cpu_offset);
+
+    tcg_gen_movi_ptr(ptr, 0);
+    tcg_gen_add_ptr(ptr, ptr, cpu_offset_as_ptr);
+    tcg_gen_ld_ptr(used, ptr,
+                   offsetof(struct qemu_plugin_mem_buffer_vcpu, used));
+    tcg_gen_brcondi_ptr(TCG_COND_LEU, used, 0, after_flush);
+
+    tcg_gen_movi_ptr(buf, 0);
+    gen_helper_plugin_vcpu_mem_buffer_flush(cpu_index, buf);
+    gen_set_label(after_flush);
+
+    tcg_temp_free_ptr(buf);
+    tcg_temp_free_ptr(used);
+    tcg_temp_free_ptr(ptr);
+    tcg_temp_free_ptr(cpu_offset_as_ptr);
+    tcg_temp_free_i32(cpu_offset);
+    tcg_temp_free_i32(cpu_index);
+}
+
 /*
  * Share the same function for enable/disable. When enabling, the NULL
  * pointer will be overwritten later.
@@ -217,11 +349,15 @@ static void plugin_gen_empty_callback(enum plugin_gen_from from)
          */
         gen_wrapped(from, PLUGIN_GEN_ENABLE_MEM_HELPER,
                     gen_empty_mem_helper);
+        gen_wrapped(from, PLUGIN_GEN_CB_MEM_BUFFER,
+                    gen_empty_mem_buffer_check);
         /* fall through */
     case PLUGIN_GEN_FROM_TB:
         gen_wrapped(from, PLUGIN_GEN_CB_UDATA, gen_empty_udata_cb_no_rwg);
         gen_wrapped(from, PLUGIN_GEN_CB_UDATA_R, gen_empty_udata_cb_no_wg);
         gen_wrapped(from, PLUGIN_GEN_CB_INLINE, gen_empty_inline_cb);
+        /* must follow the inline ops, see *_exec_cond_cb() */
+        gen_wrapped(from, PLUGIN_GEN_CB_COND, gen_empty_cond_cb);
         break;
     default:
         g_assert_not_reached();
@@ -239,6 +375,10 @@ void plugin_gen_empty_mem_callback(TCGv_i64 addr, uint32_t info)
     gen_plugin_cb_start(PLUGIN_GEN_FROM_MEM, PLUGIN_GEN_CB_INLINE, rw);
     gen_empty_inline_cb();
     tcg_gen_plugin_cb_end();
+
+    gen_plugin_cb_start(PLUGIN_GEN_FROM_MEM, PLUGIN_GEN_CB_MEM_BUFFER, rw);
+    gen_empty_mem_buffer_cb(addr, info);
+    tcg_gen_plugin_cb_end();
 }
 
 static TCGOp *find_op(TCGOp *op, TCGOpcode opc)
@@ -375,6 +515,85 @@ static TCGOp *copy_mul_i32(TCGOp **begin_op, TCGOp *op, uint32_t v)
     return op;
 }
 
+static TCGOp *copy_ld_ptr(TCGOp **begin_op, TCGOp *op)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        op = copy_op(begin_op, op, INDEX_op_ld_i32);
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_ld_i64);
+    }
+    return op;
+}
+
+static TCGOp *copy_st_const_i64(TCGOp **begin_op, TCGOp *op, uint64_t v)
+{
+    if (TCG_TARGET_REG_BITS == 32) {
+        /* 2x st_i32, in the order chosen by tcg_gen_st_i64 */
+        op = copy_op(begin_op, op, INDEX_op_st_i32);
+        op->args[0] = tcgv_i32_arg(tcg_constant_i32(HOST_BIG_ENDIAN ?
+                                                    v >> 32 : v));
+        op = copy_op(begin_op, op, INDEX_op_st_i32);
+        op->args[0] = tcgv_i32_arg(tcg_constant_i32(HOST_BIG_ENDIAN ?
+                                                    v : v >> 32));
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_st_i64);
+        op->args[0] = tcgv_i64_arg(tcg_constant_i64(v));
+    }
+    return op;
+}
+
+/* each copy of a branch targets its own label */
+static void add_label_use(TCGLabel *l, TCGOp *op)
+{
+    TCGLabelUse *u = tcg_malloc(sizeof(TCGLabelUse));
+
+    u->op = op;
+    QSIMPLEQ_INSERT_TAIL(&l->branches, u, next);
+}
+
+static TCGOp *copy_brcond_i64(TCGOp **begin_op, TCGOp *op, TCGCond cond,
+                              uint64_t v, TCGLabel *l)
+{
+    if (TCG_TARGET_REG_BITS == 32) {
+        op = copy_op(begin_op, op, INDEX_op_brcond2_i32);
+        op->args[2] = tcgv_i32_arg(tcg_constant_i32(v));
+        op->args[3] = tcgv_i32_arg(tcg_constant_i32(v >> 32));
+        op->args[4] = cond;
+        op->args[5] = label_arg(l);
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_brcond_i64);
+        op->args[1] = tcgv_i64_arg(tcg_constant_i64(v));
+        op->args[2] = cond;
+        op->args[3] = label_arg(l);
+    }
+    add_label_use(l, op);
+    return op;
+}
+
+static TCGOp *copy_brcond_ptr(TCGOp **begin_op, TCGOp *op, TCGCond cond,
+                              uintptr_t v, TCGLabel *l)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        op = copy_op(begin_op, op, INDEX_op_brcond_i32);
+        op->args[1] = tcgv_i32_arg(tcg_constant_i32(v));
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_brcond_i64);
+        op->args[1] = tcgv_i64_arg(tcg_constant_i64(v));
+    }
+    op->args[2] = cond;
+    op->args[3] = label_arg(l);
+    add_label_use(l, op);
+    return op;
+}
+
+static TCGOp *copy_set_label(TCGOp **begin_op, TCGOp *op, TCGLabel *l)
+{
+    op = copy_op(begin_op, op, INDEX_op_set_label);
+    op->args[0] = label_arg(l);
+    l->present = true;
+    return op;
+}
+
 static TCGOp *copy_st_ptr(TCGOp **begin_op, TCGOp *op)
 {
     if (UINTPTR_MAX == UINT32_MAX) {
@@ -456,6 +675,51 @@ static TCGOp *append_inline_cb(const struct qemu_plugin_dyn_cb *cb,
     return op;
 }
 
+static TCGCond plugin_cond_to_tcgcond(enum qemu_plugin_cond cond)
+{
+    switch (cond) {
+    case QEMU_PLUGIN_COND_EQ:
+        return TCG_COND_EQ;
+    case QEMU_PLUGIN_COND_NE:
+        return TCG_COND_NE;
+    case QEMU_PLUGIN_COND_LT:
+        return TCG_COND_LTU;
+    case QEMU_PLUGIN_COND_LE:
+        return TCG_COND_LEU;
+    case QEMU_PLUGIN_COND_GT:
+        return TCG_COND_GTU;
+    case QEMU_PLUGIN_COND_GE:
+        return TCG_COND_GEU;
+    default:
+        /* ALWAYS and NEVER conditions are handled at registration */
+        g_assert_not_reached();
+    }
+}
+
+static TCGOp *append_cond_cb(const struct qemu_plugin_dyn_cb *cb,
+                             TCGOp *begin_op, TCGOp *op, int *cb_idx)
+{
+    char *ptr = cb->cond.entry.score->data->data;
+    size_t elem_size = g_array_get_element_size(
+        cb->cond.entry.score->data);
+    size_t offset = cb->cond.entry.offset;
+    TCGCond cond = tcg_invert_cond(plugin_cond_to_tcgcond(cb->cond.cond));
+    TCGLabel *after_cb = gen_new_label();
+
+    op = copy_ld_i32(&begin_op, op);
+    op = copy_mul_i32(&begin_op, op, elem_size);
+    op = copy_ext_i32_ptr(&begin_op, op);
+    op = copy_const_ptr(&begin_op, op, ptr + offset);
+    op = copy_add_ptr(&begin_op, op);
+    op = copy_ld_i64(&begin_op, op);
+    /* skip the call if the condition does not hold */
+    op = copy_brcond_i64(&begin_op, op, cond, cb->cond.imm, after_cb);
+    op = copy_const_ptr(&begin_op, op, cb->userp);
+    op = copy_call(&begin_op, op, cb->f.vcpu_udata, cb_idx);
+    op = copy_set_label(&begin_op, op, after_cb);
+    return op;
+}
+
 static TCGOp *append_mem_cb(const struct qemu_plugin_dyn_cb *cb,
                             TCGOp *begin_op, TCGOp *op, int *cb_idx)
 {
@@ -485,6 +749,30 @@ static TCGOp *append_mem_cb(const struct qemu_plugin_dyn_cb *cb,
     return op;
 }
 
+static TCGOp *append_mem_buffer_cb(const struct qemu_plugin_dyn_cb *cb,
+                                   TCGOp *begin_op, TCGOp *op, int *unused)
+{
+    struct qemu_plugin_scoreboard *score = cb->mem_buffer.buf->score;
+    size_t elem_size = g_array_get_element_size(score->data);
+
+    op = copy_ld_i32(&begin_op, op);
+    op = copy_mul_i32(&begin_op, op, elem_size);
+    op = copy_ext_i32_ptr(&begin_op, op);
+    op = copy_const_ptr(&begin_op, op, score->data->data);
+    op = copy_add_ptr(&begin_op, op);
+    op = copy_ld_ptr(&begin_op, op);
+    op = copy_add_ptr(&begin_op, op);
+    /* vaddr */
+    op = copy_st_i64(&begin_op, op);
+    /* pc */
+    op = copy_st_const_i64(&begin_op, op, cb->mem_buffer.pc);
+    /* info, which remains as is */
+    op = copy_op(&begin_op, op, INDEX_op_st_i32);
+    op = copy_add_ptr(&begin_op, op);
+    op = copy_st_ptr(&begin_op, op);
+    return op;
+}
+
 typedef TCGOp *(*inject_fn)(const struct qemu_plugin_dyn_cb *cb,
                             TCGOp *begin_op, TCGOp *op, int *intp);
 typedef bool (*op_ok_fn)(const TCGOp *op, const struct qemu_plugin_dyn_cb *cb);
@@ -502,6 +790,60 @@ static bool op_rw(const TCGOp *op, const struct qemu_plugin_dyn_cb *cb)
     return !!(cb->rw & (w + 1));
 }
 
+/*
+ * Count the records that @cb appends during the instruction whose
+ * callbacks start at @op, i.e. its mem buffer templates up to the next
+ * insn_start.  Those have not been injected yet.
+ */
+static size_t count_mem_buffer_records(const TCGOp *op,
+                                       const struct qemu_plugin_dyn_cb *cb)
+{
+    size_t n = 0;
+
+    for (op = QTAILQ_NEXT(op, link);
+         op && op->opc != INDEX_op_insn_start;
+         op = QTAILQ_NEXT(op, link)) {
+        if (op->opc == INDEX_op_plugin_cb_start &&
+            op->args[0] == PLUGIN_GEN_FROM_MEM &&
+            op->args[1] == PLUGIN_GEN_CB_MEM_BUFFER &&
+            op_rw(op, cb)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static TCGOp *append_mem_buffer_check(const struct qemu_plugin_dyn_cb *cb,
+                                      TCGOp *begin_op, TCGOp *op, int *cb_idx)
+{
+    struct qemu_plugin_mem_buffer *buf = cb->mem_buffer.buf;
+    size_t elem_size = g_array_get_element_size(buf->score->data);
+    size_t n = count_mem_buffer_records(begin_op, cb);
+    uintptr_t limit;
+    TCGLabel *after_flush;
+
+    if (n == 0) {
+        return op;
+    }
+    /* helpers leave half of the buffer free, see exec_mem_buffer() */
+    g_assert(n <= buf->n_records / 2);
+    limit = (buf->n_records - n) * sizeof(struct qemu_plugin_mem_record);
+    after_flush = gen_new_label();
+
+    op = copy_ld_i32(&begin_op, op);
+    op = copy_mul_i32(&begin_op, op, elem_size);
+    op = copy_ext_i32_ptr(&begin_op, op);
+    op = copy_const_ptr(&begin_op, op, buf->score->data->data);
+    op = copy_add_ptr(&begin_op, op);
+    op = copy_ld_ptr(&begin_op, op);
+    op = copy_brcond_ptr(&begin_op, op, TCG_COND_LEU, limit, after_flush);
+    op = copy_const_ptr(&begin_op, op, buf);
+    op = copy_call(&begin_op, op, helper_plugin_vcpu_mem_buffer_flush,
+                   cb_idx);
+    op = copy_set_label(&begin_op, op, after_flush);
+    return op;
+}
+
 static void inject_cb_type(const GArray *cbs, TCGOp *begin_op,
                            inject_fn inject, op_ok_fn ok)
 {
@@ -543,12 +885,30 @@ inject_inline_cb(const GArray *cbs, TCGOp *begin_op, op_ok_fn ok)
     inject_cb_type(cbs, begin_op, append_inline_cb, ok);
 }
 
+static void
+inject_cond_cb(const GArray *cbs, TCGOp *begin_op)
+{
+    inject_cb_type(cbs, begin_op, append_cond_cb, op_ok);
+}
+
 static void
 inject_mem_cb(const GArray *cbs, TCGOp *begin_op)
 {
     inject_cb_type(cbs, begin_op, append_mem_cb, op_rw);
 }
 
+static void
+inject_mem_buffer_cb(const GArray *cbs, TCGOp *begin_op)
+{
+    inject_cb_type(cbs, begin_op, append_mem_buffer_cb, op_rw);
+}
+
+static void
+inject_mem_buffer_check(const GArray *cbs, TCGOp *begin_op)
+{
+    inject_cb_type(cbs, begin_op, append_mem_buffer_check, op_ok);
+}
+
 /* we could change the ops in place, but we can reuse more code by copying */
 static void inject_mem_helper(TCGOp *begin_op, GArray *arr)
 {
@@ -584,12 +944,13 @@ static void inject_mem_enable_helper(struct qemu_plugin_tb *ptb,
                                      struct qemu_plugin_insn *plugin_insn,
                                      TCGOp *begin_op)
 {
-    GArray *cbs[2];
+    GArray *cbs[3];
     GArray *arr;
     size_t n_cbs, i;
 
     cbs[0] = plugin_insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_REGULAR];
     cbs[1] = plugin_insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_INLINE];
+    cbs[2] = plugin_insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_MEM_BUFFER];
 
     n_cbs = 0;
     for (i = 0; i < ARRAY_SIZE(cbs); i++) {
@@ -661,6 +1022,12 @@ static void plugin_gen_tb_inline(const struct qemu_plugin_tb *ptb,
     inject_inline_cb(ptb->cbs[PLUGIN_CB_INLINE], begin_op, op_ok);
 }
 
+static void plugin_gen_tb_cond(const struct qemu_plugin_tb *ptb,
+                               TCGOp *begin_op)
+{
+    inject_cond_cb(ptb->cbs[PLUGIN_CB_COND], begin_op);
+}
+
 static void plugin_gen_insn_udata(const struct qemu_plugin_tb *ptb,
                                   TCGOp *begin_op, int insn_idx)
 {
@@ -685,6 +1052,23 @@ static void plugin_gen_insn_inline(const struct qemu_plugin_tb *ptb,
                      begin_op, op_ok);
 }
 
+static void plugin_gen_insn_cond(const struct qemu_plugin_tb *ptb,
+                                 TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_cond_cb(insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_COND], begin_op);
+}
+
+static void plugin_gen_insn_mem_buffer(const struct qemu_plugin_tb *ptb,
+                                       TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_mem_buffer_check(insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_MEM_BUFFER],
+                            begin_op);
+}
+
 static void plugin_gen_mem_regular(const struct qemu_plugin_tb *ptb,
                                    TCGOp *begin_op, int insn_idx)
 {
@@ -702,6 +1086,15 @@ static void plugin_gen_mem_inline(const struct qemu_plugin_tb *ptb,
     inject_inline_cb(cbs, begin_op, op_rw);
 }
 
+static void plugin_gen_mem_buffer(const struct qemu_plugin_tb *ptb,
+                                  TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_mem_buffer_cb(insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_MEM_BUFFER],
+                         begin_op);
+}
+
 static void plugin_gen_enable_mem_helper(struct qemu_plugin_tb *ptb,
                                          TCGOp *begin_op, int insn_idx)
 {
@@ -751,9 +1144,15 @@ static void pr_ops(void)
             case PLUGIN_GEN_CB_INLINE:
                 type = "inline";
                 break;
+            case PLUGIN_GEN_CB_COND:
+                type = "cond";
+                break;
             case PLUGIN_GEN_CB_MEM:
                 type = "mem";
                 break;
+            case PLUGIN_GEN_CB_MEM_BUFFER:
+                type = "mem buffer";
+                break;
             case PLUGIN_GEN_ENABLE_MEM_HELPER:
                 type = "enable mem helper";
                 break;
@@ -802,6 +1201,9 @@ static void plugin_gen_inject(struct qemu_plugin_tb *plugin_tb)
                 case PLUGIN_GEN_CB_INLINE:
                     plugin_gen_tb_inline(plugin_tb, op);
                     break;
+                case PLUGIN_GEN_CB_COND:
+                    plugin_gen_tb_cond(plugin_tb, op);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -821,9 +1223,15 @@ static void plugin_gen_inject(struct qemu_plugin_tb *plugin_tb)
                 case PLUGIN_GEN_CB_INLINE:
                     plugin_gen_insn_inline(plugin_tb, op, insn_idx);
                     break;
+                case PLUGIN_GEN_CB_COND:
+                    plugin_gen_insn_cond(plugin_tb, op, insn_idx);
+                    break;
                 case PLUGIN_GEN_ENABLE_MEM_HELPER:
                     plugin_gen_enable_mem_helper(plugin_tb, op, insn_idx);
                     break;
+                case PLUGIN_GEN_CB_MEM_BUFFER:
+                    plugin_gen_insn_mem_buffer(plugin_tb, op, insn_idx);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -840,6 +1248,9 @@ static void plugin_gen_inject(struct qemu_plugin_tb *plugin_tb)
                 case PLUGIN_GEN_CB_INLINE:
                     plugin_gen_mem_inline(plugin_tb, op, insn_idx);
                     break;
+                case PLUGIN_GEN_CB_MEM_BUFFER:
+                    plugin_gen_mem_buffer(plugin_tb, op, insn_idx);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -35,8 +35,26 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    unsigned tb_evict_count;
+    unsigned tb_evicted_count;
+
+    /* time spent in exclusive context, in nanoseconds */
+    uint64_t tb_flush_time;
+    uint64_t tb_flush_time_max;
+    uint64_t tb_evict_time;
+    uint64_t tb_evict_time_max;
 };
 
 extern TBContext tb_ctx;
 
+/*
+ * Changes whenever host code may have been reused for other TBs,
+ * i.e. on both flushes and region evictions.
+ */
+static inline unsigned tb_code_generation(void)
+{
+    return qatomic_read(&tb_ctx.tb_flush_count) +
+           qatomic_read(&tb_ctx.tb_evict_count);
+}
+
 #endif
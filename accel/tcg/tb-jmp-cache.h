@@ -9,8 +9,14 @@
 #ifndef ACCEL_TCG_TB_JMP_CACHE_H
 #define ACCEL_TCG_TB_JMP_CACHE_H
 
+/* Default and limits for "jmp-cache-bits". */
 #define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+#define TB_JMP_CACHE_MIN_BITS 6
+#define TB_JMP_CACHE_MAX_BITS 18
+
+/* Limits for the optional second level, see "jmp-cache-l2-*". */
+#define TB_JMP_CACHE_L2_MAX_BITS 20
+#define TB_JMP_CACHE_L2_MAX_WAYS 16
 
 /*
  * Invalidated in parallel; all accesses to 'tb' must be atomic.
@@ -19,12 +25,55 @@
  * non-NULL value of 'tb'.  Strictly speaking pc is only needed for
  * CF_PCREL, but it's used always for simplicity.
  */
+typedef struct CPUJumpCacheEntry {
+    TranslationBlock *tb;
+    vaddr pc;
+} CPUJumpCacheEntry;
+
+/*
+ * The direct-mapped first level.  With "jmp-cache-adaptive", it may be
+ * replaced by the owning CPU at any time; other CPUs must access it
+ * with qatomic_rcu_read() within an RCU read-side critical section.
+ */
+typedef struct CPUJumpCacheTable {
+    struct rcu_head rcu;
+    unsigned bits;
+    CPUJumpCacheEntry array[];
+} CPUJumpCacheTable;
+
 struct CPUJumpCache {
     struct rcu_head rcu;
-    struct {
-        TranslationBlock *tb;
-        vaddr pc;
-    } array[TB_JMP_CACHE_SIZE];
+    CPUJumpCacheTable *l1;
+
+    /*
+     * Lookup statistics.  Only written by the owning CPU, and only with
+     * qatomic_set, so that they can be read by the monitor at any time.
+     * They are only kept if 'stats' is set, that is with "jmp-cache-stats"
+     * or with "jmp-cache-adaptive", which needs lookups and l1_misses.
+     * l2_misses is only counted when the second level exists.
+     */
+    bool stats;
+    size_t lookups;
+    size_t l1_misses;
+    size_t l2_misses;
+    size_t resizes;
+
+    /* Counter values at the start of the current resize window. */
+    size_t window_lookups;
+    size_t window_misses;
+
+    /*
+     * The optional second level is consulted when 'l1' misses, before
+     * falling back to the global hash table.  It is set associative, with
+     * (1 << l2_bits) sets of l2_ways entries each, and indexed like 'l1'
+     * so that all the sets for one page are contiguous.  l2_bits == 0
+     * means that the second level is disabled.  Entries follow the same
+     * rules as those of 'l1'.
+     */
+    unsigned l2_bits;
+    unsigned l2_ways;
+    unsigned l2_next;       /* picks the way to replace, for all sets */
+    CPUJumpCacheEntry l2[];
 };
 
 #endif /* ACCEL_TCG_TB_JMP_CACHE_H */
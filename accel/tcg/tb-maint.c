@@ -20,6 +20,7 @@
 #include "qemu/osdep.h"
 #include "qemu/interval-tree.h"
 #include "qemu/qtree.h"
+#include "qemu/timer.h"
 #include "exec/cputlb.h"
 #include "exec/log.h"
 #include "exec/exec-all.h"
@@ -754,17 +755,20 @@ static void tb_remove(TranslationBlock *tb)
 }
 #endif /* CONFIG_USER_ONLY */
 
-/* flush all the translation blocks */
-static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
+static void tb_account_time(uint64_t *total, uint64_t *max, int64_t start)
 {
-    bool did_flush = false;
+    uint64_t delta = get_clock() - start;
 
-    mmap_lock();
-    /* If it is already been done on request of another CPU, just retry. */
-    if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
-        goto done;
+    qatomic_set_u64(total, qatomic_read_u64(total) + delta);
+    if (delta > qatomic_read_u64(max)) {
+        qatomic_set_u64(max, delta);
     }
-    did_flush = true;
+}
+
+static void tb_flush__locked(void)
+{
+    int64_t start = get_clock();
+    CPUState *cpu;
 
     CPU_FOREACH(cpu) {
         tcg_flush_jmp_cache(cpu);
@@ -777,6 +781,22 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
     /* XXX: flush processor icache at this point if cache flush is expensive */
     qatomic_inc(&tb_ctx.tb_flush_count);
 
+    tb_account_time(&tb_ctx.tb_flush_time, &tb_ctx.tb_flush_time_max, start);
+}
+
+/* flush all the translation blocks */
+static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    bool did_flush = false;
+
+    mmap_lock();
+    /* If it is already been done on request of another CPU, just retry. */
+    if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
+        goto done;
+    }
+    did_flush = true;
+    tb_flush__locked();
+
 done:
     mmap_unlock();
     if (did_flush) {
@@ -884,13 +904,27 @@ static void tb_jmp_cache_inval_tb(TranslationBlock *tb)
             tcg_flush_jmp_cache(cpu);
         }
     } else {
-        uint32_t h = tb_jmp_cache_hash_func(tb->pc);
+        /* The first level may be resized concurrently by its owner. */
+        RCU_READ_LOCK_GUARD();
 
         CPU_FOREACH(cpu) {
             CPUJumpCache *jc = cpu->tb_jmp_cache;
+            CPUJumpCacheTable *l1 = qatomic_rcu_read(&jc->l1);
+            uint32_t h = tb_jmp_cache_hash_func(tb->pc, l1->bits);
 
-            if (qatomic_read(&jc->array[h].tb) == tb) {
-                qatomic_set(&jc->array[h].tb, NULL);
+            if (qatomic_read(&l1->array[h].tb) == tb) {
+                qatomic_set(&l1->array[h].tb, NULL);
+            }
+            if (jc->l2_bits) {
+                CPUJumpCacheEntry *set;
+
+                set = &jc->l2[tb_jmp_cache_hash_func(tb->pc, jc->l2_bits)
+                              * jc->l2_ways];
+                for (unsigned i = 0; i < jc->l2_ways; i++) {
+                    if (qatomic_read(&set[i].tb) == tb) {
+                        qatomic_set(&set[i].tb, NULL);
+                    }
+                }
             }
         }
     }
@@ -901,7 +935,13 @@ static void tb_jmp_cache_inval_tb(TranslationBlock *tb)
  * In !user-mode, if @rm_from_page_list is set, call with the TB's pages'
  * locks held.
  */
-static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
+/*
+ * With @evict, the host code of @tb is about to be reused: this is
+ * accounted separately, and the jump caches are purged in bulk by
+ * tb_jmp_cache_evict().
+ */
+static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list,
+                                  bool evict)
 {
     uint32_t h;
     tb_page_addr_t phys_pc;
@@ -928,7 +968,9 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    tb_jmp_cache_inval_tb(tb);
+    if (!evict) {
+        tb_jmp_cache_inval_tb(tb);
+    }
 
     /* suppress this TB from the two jump lists */
     tb_remove_from_jmp_list(tb, 0);
@@ -937,17 +979,29 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     /* suppress any remaining jumps to this TB */
     tb_jmp_unlink(tb);
 
-    qatomic_set(&tb_ctx.tb_phys_invalidate_count,
-                tb_ctx.tb_phys_invalidate_count + 1);
+    if (evict) {
+        qatomic_set(&tb_ctx.tb_evicted_count, tb_ctx.tb_evicted_count + 1);
+    } else {
+        qatomic_set(&tb_ctx.tb_phys_invalidate_count,
+                    tb_ctx.tb_phys_invalidate_count + 1);
+    }
 }
 
 static void tb_phys_invalidate__locked(TranslationBlock *tb)
 {
     qemu_thread_jit_write();
-    do_tb_phys_invalidate(tb, true);
+    do_tb_phys_invalidate(tb, true, false);
     qemu_thread_jit_execute();
 }
 
+/* Called from do_tb_evict(), in a safe-work context. */
+static void tb_phys_evict(TranslationBlock *tb)
+{
+    tb_lock_pages(tb);
+    do_tb_phys_invalidate(tb, true, true);
+    tb_unlock_pages(tb);
+}
+
 /*
  * Invalidate one TB.
  * Called with mmap_lock held in user-mode.
@@ -956,10 +1010,108 @@ void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr)
 {
     if (page_addr == -1 && tb_page_addr0(tb) != -1) {
         tb_lock_pages(tb);
-        do_tb_phys_invalidate(tb, true);
+        do_tb_phys_invalidate(tb, true, false);
         tb_unlock_pages(tb);
     } else {
-        do_tb_phys_invalidate(tb, false);
+        do_tb_phys_invalidate(tb, false, false);
+    }
+}
+
+static gboolean tb_evict_iter(gpointer key, gpointer value, gpointer data)
+{
+    tb_phys_evict(value);
+    return false;
+}
+
+static void tb_jmp_cache_entry_evict(CPUJumpCacheEntry *e)
+{
+    TranslationBlock *tb = qatomic_read(&e->tb);
+
+    if (tb && tcg_region_evicting(tb)) {
+        qatomic_set(&e->tb, NULL);
+    }
+}
+
+/*
+ * Drop the entries of the jump caches that point into the regions being
+ * evicted.  One pass over each cache is much cheaper than looking up
+ * every evicted TB, which for CF_PCREL would flush the caches anyway.
+ */
+static void tb_jmp_cache_evict(void)
+{
+    CPUState *cpu;
+
+    RCU_READ_LOCK_GUARD();
+
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = cpu->tb_jmp_cache;
+        CPUJumpCacheTable *l1;
+
+        if (unlikely(jc == NULL)) {
+            continue;
+        }
+        l1 = qatomic_rcu_read(&jc->l1);
+        for (size_t i = 0, n = 1 << l1->bits; i < n; i++) {
+            tb_jmp_cache_entry_evict(&l1->array[i]);
+        }
+        if (jc->l2_bits) {
+            for (size_t i = 0, n = jc->l2_ways << jc->l2_bits; i < n; i++) {
+                tb_jmp_cache_entry_evict(&jc->l2[i]);
+            }
+        }
+    }
+}
+
+/*
+ * Make room after tcg_tb_alloc() failed, by retiring the oldest code
+ * regions.  Falls back to a full flush when eviction is disabled or not
+ * possible.  Plugins may also keep state for translated code that is
+ * only released by a full flush, so they always get one.
+ */
+static void do_tb_evict(CPUState *cpu, run_on_cpu_data tb_gen)
+{
+    bool did_flush = false;
+    int64_t start;
+
+    mmap_lock();
+    /* If it is already been done on request of another CPU, just retry. */
+    if (tb_code_generation() != tb_gen.host_int) {
+        goto done;
+    }
+
+    if (qemu_plugin_loaded() || !tcg_region_evict_prepare()) {
+        did_flush = true;
+        tb_flush__locked();
+        goto done;
+    }
+
+    start = get_clock();
+    qemu_thread_jit_write();
+    tcg_region_evict_foreach(tb_evict_iter, NULL);
+    qemu_thread_jit_execute();
+    tb_jmp_cache_evict();
+    tcg_region_evict_commit();
+    qatomic_inc(&tb_ctx.tb_evict_count);
+    tb_account_time(&tb_ctx.tb_evict_time, &tb_ctx.tb_evict_time_max, start);
+
+done:
+    mmap_unlock();
+    if (did_flush) {
+        qemu_plugin_flush_cb();
+    }
+}
+
+void tb_evict(CPUState *cpu)
+{
+    if (tcg_enabled()) {
+        unsigned tb_gen = tb_code_generation();
+
+        if (cpu_in_serial_context(cpu)) {
+            do_tb_evict(cpu, RUN_ON_CPU_HOST_INT(tb_gen));
+        } else {
+            async_safe_run_on_cpu(cpu, do_tb_evict,
+                                  RUN_ON_CPU_HOST_INT(tb_gen));
+        }
     }
 }
 
@@ -28,6 +28,7 @@
 #include "exec/replay-core.h"
 #include "sysemu/cpu-timers.h"
 #include "tcg/startup.h"
+#include "tcg/tcg.h"
 #include "tcg/oversized-guest.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
@@ -38,7 +39,9 @@
 #if !defined(CONFIG_USER_ONLY)
 #include "hw/boards.h"
 #endif
+#include "internal-common.h"
 #include "internal-target.h"
+#include "tb-jmp-cache.h"
 
 struct TCGState {
     AccelState parent_obj;
@@ -47,6 +50,19 @@ struct TCGState {
     bool one_insn_per_tb;
     int splitwx_enabled;
     unsigned long tb_size;
+    bool tb_evict;
+    bool tb_numa;
+    bool tb_hugepages;
+    uint32_t jmp_cache_bits;
+    bool jmp_cache_adaptive;
+    bool jmp_cache_stats;
+    uint32_t jmp_cache_l2_bits;
+    uint32_t jmp_cache_l2_ways;
+    uint32_t victim_tlb_size;
+    uint32_t victim_tlb_ways;
+    bool cse;
+    bool cse_loads;
+    uint32_t profile_period;
 };
 typedef struct TCGState TCGState;
 
@@ -94,11 +110,26 @@ static void tcg_accel_instance_init(Object *obj)
     s->splitwx_enabled = -1;
 #else
     s->splitwx_enabled = 0;
+#endif
+    s->jmp_cache_bits = TB_JMP_CACHE_BITS;
+    s->jmp_cache_l2_ways = 4;
+#ifndef CONFIG_USER_ONLY
+    s->victim_tlb_size = CPU_VTLB_DEFAULT_SIZE;
+    s->victim_tlb_ways = CPU_VTLB_DEFAULT_SIZE;
 #endif
 }
 
 bool mttcg_enabled;
 bool one_insn_per_tb;
+unsigned tb_jmp_cache_bits = TB_JMP_CACHE_BITS;
+bool tb_jmp_cache_adaptive;
+bool tb_jmp_cache_stats;
+unsigned tb_jmp_cache_l2_bits;
+unsigned tb_jmp_cache_l2_ways;
+#ifndef CONFIG_USER_ONLY
+unsigned tlb_victim_size = CPU_VTLB_DEFAULT_SIZE;
+unsigned tlb_victim_ways = CPU_VTLB_DEFAULT_SIZE;
+#endif
 
 static int tcg_init_machine(MachineState *ms)
 {
@@ -111,10 +142,26 @@ static int tcg_init_machine(MachineState *ms)
 
     tcg_allowed = true;
     mttcg_enabled = s->mttcg_enabled;
+    tb_jmp_cache_bits = s->jmp_cache_bits;
+    tb_jmp_cache_adaptive = s->jmp_cache_adaptive;
+    tb_jmp_cache_stats = s->jmp_cache_stats;
+    tb_jmp_cache_l2_bits = s->jmp_cache_l2_bits;
+    tb_jmp_cache_l2_ways = s->jmp_cache_l2_ways;
+#ifndef CONFIG_USER_ONLY
+    tlb_victim_size = s->victim_tlb_size;
+    tlb_victim_ways = s->victim_tlb_ways;
+#endif
 
     page_init();
     tb_htable_init();
-    tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_cpus);
+    tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_cpus,
+             (s->tb_evict ? TCG_INIT_EVICT : 0) |
+             (s->tb_numa ? TCG_INIT_NUMA : 0) |
+             (s->tb_hugepages ? TCG_INIT_HUGEPAGES : 0));
+
+    /* Per-thread contexts are copied from this one when vCPUs start. */
+    tcg_ctx->opt_flags = (s->cse ? TCG_OPT_CSE : 0) |
+                         (s->cse_loads ? TCG_OPT_CSE_LD : 0);
 
 #if defined(CONFIG_SOFTMMU)
     /*
@@ -122,6 +169,8 @@ static int tcg_init_machine(MachineState *ms)
      * initialize the prologue now.
      */
     tcg_prologue_init();
+    tcg_stats_init();
+    tcg_profile_init(s->profile_period, max_cpus);
 #endif
 
     return 0;
@@ -181,6 +230,269 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_jmp_cache_bits(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->jmp_cache_bits;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_bits(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value < TB_JMP_CACHE_MIN_BITS || value > TB_JMP_CACHE_MAX_BITS) {
+        error_setg(errp, "'%s' must be between %d and %d", name,
+                   TB_JMP_CACHE_MIN_BITS, TB_JMP_CACHE_MAX_BITS);
+        return;
+    }
+
+    s->jmp_cache_bits = value;
+}
+
+static bool tcg_get_tb_evict(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->tb_evict;
+}
+
+static void tcg_set_tb_evict(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->tb_evict = value;
+}
+
+static bool tcg_get_tb_numa(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->tb_numa;
+}
+
+static void tcg_set_tb_numa(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->tb_numa = value;
+}
+
+static bool tcg_get_tb_hugepages(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->tb_hugepages;
+}
+
+static void tcg_set_tb_hugepages(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->tb_hugepages = value;
+}
+
+static bool tcg_get_jmp_cache_adaptive(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->jmp_cache_adaptive;
+}
+
+static void tcg_set_jmp_cache_adaptive(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->jmp_cache_adaptive = value;
+}
+
+static bool tcg_get_jmp_cache_stats(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->jmp_cache_stats;
+}
+
+static void tcg_set_jmp_cache_stats(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->jmp_cache_stats = value;
+}
+
+static void tcg_get_jmp_cache_l2_bits(Object *obj, Visitor *v,
+                                      const char *name, void *opaque,
+                                      Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->jmp_cache_l2_bits;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_l2_bits(Object *obj, Visitor *v,
+                                      const char *name, void *opaque,
+                                      Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value > TB_JMP_CACHE_L2_MAX_BITS) {
+        error_setg(errp, "'%s' must be at most %d", name,
+                   TB_JMP_CACHE_L2_MAX_BITS);
+        return;
+    }
+
+    s->jmp_cache_l2_bits = value;
+}
+
+static void tcg_get_jmp_cache_l2_ways(Object *obj, Visitor *v,
+                                      const char *name, void *opaque,
+                                      Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->jmp_cache_l2_ways;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_l2_ways(Object *obj, Visitor *v,
+                                      const char *name, void *opaque,
+                                      Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (!is_power_of_2(value) || value > TB_JMP_CACHE_L2_MAX_WAYS) {
+        error_setg(errp, "'%s' must be a power of 2 no larger than %d",
+                   name, TB_JMP_CACHE_L2_MAX_WAYS);
+        return;
+    }
+
+    s->jmp_cache_l2_ways = value;
+}
+
+#ifndef CONFIG_USER_ONLY
+static void tcg_get_victim_tlb_size(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->victim_tlb_size;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_victim_tlb_size(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (!is_power_of_2(value) || value > CPU_VTLB_MAX_SIZE) {
+        error_setg(errp, "'%s' must be a power of 2 no larger than %d",
+                   name, CPU_VTLB_MAX_SIZE);
+        return;
+    }
+
+    s->victim_tlb_size = value;
+}
+
+static void tcg_get_victim_tlb_ways(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->victim_tlb_ways;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_victim_tlb_ways(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (!is_power_of_2(value) || value > CPU_VTLB_MAX_SIZE) {
+        error_setg(errp, "'%s' must be a power of 2 no larger than %d",
+                   name, CPU_VTLB_MAX_SIZE);
+        return;
+    }
+
+    s->victim_tlb_ways = value;
+}
+
+static void tcg_get_profile_period(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->profile_period;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_profile_period(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value && !tcg_profile_supported()) {
+        error_setg(errp, "'%s' is not supported on this host", name);
+        return;
+    }
+    if (value && (value < 100 || value > 1000000)) {
+        error_setg(errp, "'%s' must be 0 or between 100 and 1000000", name);
+        return;
+    }
+
+    s->profile_period = value;
+}
+#endif
+
+static bool tcg_get_cse(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->cse;
+}
+
+static void tcg_set_cse(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->cse = value;
+}
+
+static bool tcg_get_cse_loads(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->cse_loads;
+}
+
+static void tcg_set_cse_loads(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->cse_loads = value;
+}
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -242,6 +554,82 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add_bool(oc, "tb-evict",
+        tcg_get_tb_evict, tcg_set_tb_evict);
+    object_class_property_set_description(oc, "tb-evict",
+        "Retire the oldest TCG code regions instead of flushing all "
+        "translations when the cache is full");
+
+    object_class_property_add_bool(oc, "tb-numa",
+        tcg_get_tb_numa, tcg_set_tb_numa);
+    object_class_property_set_description(oc, "tb-numa",
+        "Place each TCG code region on the host NUMA node of its vCPU thread");
+
+    object_class_property_add_bool(oc, "tb-hugepages",
+        tcg_get_tb_hugepages, tcg_set_tb_hugepages);
+    object_class_property_set_description(oc, "tb-hugepages",
+        "Align TCG code regions to huge pages, without guard pages");
+
+    object_class_property_add(oc, "jmp-cache-bits", "int",
+        tcg_get_jmp_cache_bits, tcg_set_jmp_cache_bits,
+        NULL, NULL);
+    object_class_property_set_description(oc, "jmp-cache-bits",
+        "Log2 of the number of entries of the TB jump cache");
+
+    object_class_property_add_bool(oc, "jmp-cache-adaptive",
+        tcg_get_jmp_cache_adaptive, tcg_set_jmp_cache_adaptive);
+    object_class_property_set_description(oc, "jmp-cache-adaptive",
+        "Resize the TB jump cache depending on its miss rate");
+
+    object_class_property_add_bool(oc, "jmp-cache-stats",
+        tcg_get_jmp_cache_stats, tcg_set_jmp_cache_stats);
+    object_class_property_set_description(oc, "jmp-cache-stats",
+        "Count TB jump cache lookups and misses");
+
+    object_class_property_add(oc, "jmp-cache-l2-bits", "int",
+        tcg_get_jmp_cache_l2_bits, tcg_set_jmp_cache_l2_bits,
+        NULL, NULL);
+    object_class_property_set_description(oc, "jmp-cache-l2-bits",
+        "Log2 of the number of sets of the second level TB jump cache "
+        "(0 to disable)");
+
+    object_class_property_add(oc, "jmp-cache-l2-ways", "int",
+        tcg_get_jmp_cache_l2_ways, tcg_set_jmp_cache_l2_ways,
+        NULL, NULL);
+    object_class_property_set_description(oc, "jmp-cache-l2-ways",
+        "Associativity of the second level TB jump cache");
+
+#ifndef CONFIG_USER_ONLY
+    object_class_property_add(oc, "victim-tlb-size", "int",
+        tcg_get_victim_tlb_size, tcg_set_victim_tlb_size,
+        NULL, NULL);
+    object_class_property_set_description(oc, "victim-tlb-size",
+        "Number of entries of the victim TLB, per MMU mode");
+
+    object_class_property_add(oc, "victim-tlb-ways", "int",
+        tcg_get_victim_tlb_ways, tcg_set_victim_tlb_ways,
+        NULL, NULL);
+    object_class_property_set_description(oc, "victim-tlb-ways",
+        "Associativity of the victim TLB");
+
+    object_class_property_add(oc, "profile-period", "int",
+        tcg_get_profile_period, tcg_set_profile_period,
+        NULL, NULL);
+    object_class_property_set_description(oc, "profile-period",
+        "Sampling period of the TCG profiler in microseconds of vCPU "
+        "thread time (0 to disable)");
+#endif
+
+    object_class_property_add_bool(oc, "cse",
+        tcg_get_cse, tcg_set_cse);
+    object_class_property_set_description(oc, "cse",
+        "Eliminate common subexpressions in TCG ops");
+
+    object_class_property_add_bool(oc, "cse-loads",
+        tcg_get_cse_loads, tcg_set_cse_loads);
+    object_class_property_set_description(oc, "cse-loads",
+        "Eliminate redundant guest loads in TCG ops");
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
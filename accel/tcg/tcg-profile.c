@@ -0,0 +1,433 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Sampling profiler for translated code
+ *
+ * Each vCPU thread arms a timer on its own CPU time clock, which raises
+ * SIGPROF on that thread.  The signal handler only records the host PC
+ * into a per-vCPU ring buffer; everything else, i.e. mapping the PC back
+ * to a TB and the guest PC, happens when the rings are drained from the
+ * main loop or by the monitor.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/lockable.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+#include "qemu/error-report.h"
+#include "hw/core/cpu.h"
+#include "disas/disas.h"
+#include "tcg/tcg.h"
+#include "internal-common.h"
+#include "tb-context.h"
+
+#if defined(CONFIG_LINUX) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || \
+     defined(__riscv) || defined(__powerpc64__) || defined(__s390x__) || \
+     defined(__loongarch64))
+#define TCG_PROFILE_SUPPORTED
+#endif
+
+#define TCG_PROFILE_RING_BITS  12
+#define TCG_PROFILE_RING_SIZE  (1u << TCG_PROFILE_RING_BITS)
+#define TCG_PROFILE_RING_MASK  (TCG_PROFILE_RING_SIZE - 1)
+
+/* Bounds of the interval between two drains of the rings. */
+#define TCG_PROFILE_DRAIN_MIN_MS  10
+#define TCG_PROFILE_DRAIN_MAX_MS  1000
+
+/* Entries printed by tcg_profile_dump. */
+#define TCG_PROFILE_DUMP_MAX   32
+
+typedef struct TCGProfileSample {
+    /* sequence number + 1 of the sample, 0 while being written */
+    uint32_t seq;
+    uint32_t code_gen;
+    uintptr_t host_pc;
+    uint64_t cycles;
+} TCGProfileSample;
+
+/*
+ * Single producer, the thread running the vCPU, and single consumer,
+ * whoever holds profile.lock.  Slots are protected by a seqlock-like
+ * sequence number because the producer may lap a slow consumer.
+ */
+typedef struct TCGProfileRing {
+    uint32_t head;
+    uint32_t tail;
+    int64_t last_ticks;
+    TCGProfileSample buf[TCG_PROFILE_RING_SIZE];
+} TCGProfileRing;
+
+typedef enum {
+    TCG_PROFILE_TB,        /* guest virtual PC */
+    TCG_PROFILE_TB_PHYS,   /* guest physical PC, for CF_PCREL TBs */
+    TCG_PROFILE_JIT,       /* prologue and epilogue */
+    TCG_PROFILE_HOST,      /* host PC outside translated code */
+} TCGProfileKind;
+
+typedef struct TCGProfileEntry {
+    uint64_t key;
+    TCGProfileKind kind;
+    uint64_t samples;
+    uint64_t cycles;
+} TCGProfileEntry;
+
+static struct {
+    unsigned period_us;
+    unsigned drain_ms;
+    unsigned nb_rings;
+    TCGProfileRing **rings;
+    QEMUTimer *drain_timer;
+
+    /* Aggregated data, protected by lock.  */
+    QemuMutex lock;
+    GHashTable *entries;
+    uint64_t samples;
+    uint64_t cycles;
+    uint64_t dropped;
+    uint64_t stale;
+} profile;
+
+#ifdef TCG_PROFILE_SUPPORTED
+
+#ifdef __powerpc64__
+#include <asm/ptrace.h>
+#endif
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static __thread timer_t profile_timer;
+static __thread bool profile_timer_armed;
+
+static uintptr_t profile_signal_pc(ucontext_t *uc)
+{
+#if defined(__x86_64__)
+    return uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+    return uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+    return uc->uc_mcontext.pc;
+#elif defined(__riscv)
+    return uc->uc_mcontext.__gregs[REG_PC];
+#elif defined(__powerpc64__)
+    return uc->uc_mcontext.gp_regs[PT_NIP];
+#elif defined(__s390x__)
+    return uc->uc_mcontext.psw.addr;
+#elif defined(__loongarch64)
+    return uc->uc_mcontext.__pc;
+#endif
+}
+
+/* Must remain async-signal-safe: no locks, no allocation. */
+static void profile_signal_handler(int sig, siginfo_t *info, void *puc)
+{
+    CPUState *cpu = current_cpu;
+    TCGProfileRing *ring;
+    TCGProfileSample *s;
+    uint32_t head;
+    int64_t now;
+
+    if (!cpu || cpu->cpu_index >= profile.nb_rings) {
+        return;
+    }
+    ring = profile.rings[cpu->cpu_index];
+    head = ring->head;
+    s = &ring->buf[head & TCG_PROFILE_RING_MASK];
+    now = cpu_get_host_ticks();
+
+    qatomic_set(&s->seq, 0);
+    smp_wmb();
+    s->host_pc = profile_signal_pc(puc);
+    s->code_gen = tb_code_generation();
+    s->cycles = ring->last_ticks ? now - ring->last_ticks : 0;
+    smp_wmb();
+    qatomic_set(&s->seq, head + 1);
+    qatomic_store_release(&ring->head, head + 1);
+
+    ring->last_ticks = now;
+}
+
+bool tcg_profile_supported(void)
+{
+    return true;
+}
+
+void tcg_profile_thread_start(void)
+{
+    struct sigevent sev = {
+        .sigev_notify = SIGEV_THREAD_ID,
+        .sigev_signo = SIGPROF,
+    };
+    struct itimerspec its = {
+        .it_interval.tv_sec = profile.period_us / 1000000,
+        .it_interval.tv_nsec = (profile.period_us % 1000000) * 1000,
+    };
+    sigset_t set;
+
+    if (!profile.period_us) {
+        return;
+    }
+
+    sev.sigev_notify_thread_id = qemu_get_thread_id();
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &profile_timer) < 0) {
+        warn_report_once("tcg: cannot create profiling timer: %s",
+                         strerror(errno));
+        return;
+    }
+    its.it_value = its.it_interval;
+    timer_settime(profile_timer, 0, &its, NULL);
+    profile_timer_armed = true;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+}
+
+void tcg_profile_thread_stop(void)
+{
+    if (profile_timer_armed) {
+        timer_delete(profile_timer);
+        profile_timer_armed = false;
+    }
+}
+
+static void profile_signal_init(void)
+{
+    struct sigaction act = {
+        .sa_sigaction = profile_signal_handler,
+        .sa_flags = SA_SIGINFO | SA_RESTART,
+    };
+
+    sigfillset(&act.sa_mask);
+    sigaction(SIGPROF, &act, NULL);
+}
+
+#else
+
+bool tcg_profile_supported(void)
+{
+    return false;
+}
+
+void tcg_profile_thread_start(void)
+{
+}
+
+void tcg_profile_thread_stop(void)
+{
+}
+
+static void profile_signal_init(void)
+{
+    g_assert_not_reached();
+}
+
+#endif /* TCG_PROFILE_SUPPORTED */
+
+static guint profile_entry_hash(gconstpointer p)
+{
+    const TCGProfileEntry *e = p;
+    return g_int64_hash(&e->key) ^ e->kind;
+}
+
+static gboolean profile_entry_equal(gconstpointer a, gconstpointer b)
+{
+    const TCGProfileEntry *ea = a, *eb = b;
+    return ea->key == eb->key && ea->kind == eb->kind;
+}
+
+static void profile_account(const TCGProfileSample *s)
+{
+    TCGProfileEntry key = { .kind = TCG_PROFILE_HOST, .key = s->host_pc };
+    TCGProfileEntry *e;
+
+    /* The signal PC is in the rx mapping of the buffer, see split-wx. */
+    if (in_code_gen_buffer((const void *)(s->host_pc - tcg_splitwx_diff))) {
+        TranslationBlock *tb;
+
+        /* Host code of older generations may have been reused. */
+        if (s->code_gen != tb_code_generation()) {
+            profile.stale++;
+            return;
+        }
+        tb = tcg_tb_lookup(s->host_pc);
+        if (tb == NULL) {
+            key.kind = TCG_PROFILE_JIT;
+            key.key = 0;
+        } else if (qatomic_read(&tb->cflags) & CF_PCREL) {
+            key.kind = TCG_PROFILE_TB_PHYS;
+            key.key = tb->page_addr[0];
+        } else {
+            key.kind = TCG_PROFILE_TB;
+            key.key = tb->pc;
+        }
+        /* Discard the sample if a flush or eviction raced with the lookup. */
+        if (tb && s->code_gen != tb_code_generation()) {
+            profile.stale++;
+            return;
+        }
+    }
+
+    e = g_hash_table_lookup(profile.entries, &key);
+    if (e == NULL) {
+        e = g_memdup2(&key, sizeof(key));
+        g_hash_table_add(profile.entries, e);
+    }
+    e->samples++;
+    e->cycles += s->cycles;
+    profile.samples++;
+    profile.cycles += s->cycles;
+}
+
+static void profile_drain_ring(TCGProfileRing *ring)
+{
+    uint32_t head = qatomic_load_acquire(&ring->head);
+    uint32_t tail = ring->tail;
+
+    if (head - tail > TCG_PROFILE_RING_SIZE) {
+        profile.dropped += head - tail - TCG_PROFILE_RING_SIZE;
+        tail = head - TCG_PROFILE_RING_SIZE;
+    }
+    for (; tail != head; tail++) {
+        TCGProfileSample *slot = &ring->buf[tail & TCG_PROFILE_RING_MASK];
+        TCGProfileSample s;
+
+        s.seq = qatomic_load_acquire(&slot->seq);
+        s.code_gen = slot->code_gen;
+        s.host_pc = slot->host_pc;
+        s.cycles = slot->cycles;
+        smp_rmb();
+        if (s.seq != tail + 1 || qatomic_read(&slot->seq) != s.seq) {
+            /* Overwritten by the producer while we were reading. */
+            profile.dropped++;
+            continue;
+        }
+        profile_account(&s);
+    }
+    ring->tail = head;
+}
+
+static void profile_drain(void)
+{
+    for (unsigned i = 0; i < profile.nb_rings; i++) {
+        profile_drain_ring(profile.rings[i]);
+    }
+}
+
+static void profile_drain_timer_cb(void *opaque)
+{
+    WITH_QEMU_LOCK_GUARD(&profile.lock) {
+        profile_drain();
+    }
+    timer_mod(profile.drain_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + profile.drain_ms);
+}
+
+void tcg_profile_init(unsigned period_us, unsigned max_cpus)
+{
+    if (!period_us) {
+        return;
+    }
+    g_assert(tcg_profile_supported());
+
+    profile.period_us = period_us;
+    profile.nb_rings = max_cpus;
+    profile.rings = g_new(TCGProfileRing *, max_cpus);
+    for (unsigned i = 0; i < max_cpus; i++) {
+        profile.rings[i] = g_new0(TCGProfileRing, 1);
+    }
+    qemu_mutex_init(&profile.lock);
+    profile.entries = g_hash_table_new_full(profile_entry_hash,
+                                            profile_entry_equal,
+                                            g_free, NULL);
+
+    /*
+     * Drain often enough that the rings do not overflow: a vCPU thread
+     * uses at most one second of CPU time per second, so it fills half
+     * of its ring in RING_SIZE / 2 periods.
+     */
+    profile.drain_ms = (uint64_t)TCG_PROFILE_RING_SIZE / 2 * period_us / 1000;
+    profile.drain_ms = MIN(MAX(profile.drain_ms, TCG_PROFILE_DRAIN_MIN_MS),
+                           TCG_PROFILE_DRAIN_MAX_MS);
+    profile.drain_timer = timer_new_ms(QEMU_CLOCK_REALTIME,
+                                       profile_drain_timer_cb, NULL);
+    timer_mod(profile.drain_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + profile.drain_ms);
+
+    profile_signal_init();
+}
+
+static gint profile_entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const TCGProfileEntry *ea = *(TCGProfileEntry **)a;
+    const TCGProfileEntry *eb = *(TCGProfileEntry **)b;
+
+    if (ea->samples != eb->samples) {
+        return ea->samples < eb->samples ? 1 : -1;
+    }
+    return ea->key < eb->key ? -1 : ea->key > eb->key;
+}
+
+static void profile_dump_entry(GString *buf, const TCGProfileEntry *e)
+{
+    g_string_append_printf(buf, "%10" PRIu64 " %6.2f%% %16" PRIu64 "  ",
+                           e->samples, (double)e->samples * 100 /
+                           profile.samples, e->cycles);
+
+    switch (e->kind) {
+    case TCG_PROFILE_TB:
+        g_string_append_printf(buf, "guest 0x%016" PRIx64 " %s\n",
+                               e->key, lookup_symbol(e->key));
+        break;
+    case TCG_PROFILE_TB_PHYS:
+        g_string_append_printf(buf, "phys  0x%016" PRIx64 "\n", e->key);
+        break;
+    case TCG_PROFILE_JIT:
+        g_string_append_printf(buf, "[tcg prologue/epilogue]\n");
+        break;
+    case TCG_PROFILE_HOST:
+        g_string_append_printf(buf, "host  0x%016" PRIx64 "\n", e->key);
+        break;
+    }
+}
+
+void tcg_profile_dump(GString *buf)
+{
+    g_autoptr(GPtrArray) sorted = NULL;
+    GHashTableIter iter;
+    TCGProfileEntry *e;
+
+    if (!profile.period_us) {
+        g_string_append_printf(buf, "TCG profiler not enabled, "
+                               "use -accel tcg,profile-period=N\n");
+        return;
+    }
+
+    QEMU_LOCK_GUARD(&profile.lock);
+    profile_drain();
+
+    g_string_append_printf(buf, "TCG profile: %" PRIu64 " samples every "
+                           "%u us, %" PRIu64 " host cycles, %" PRIu64
+                           " dropped, %" PRIu64 " stale\n",
+                           profile.samples, profile.period_us,
+                           profile.cycles, profile.dropped, profile.stale);
+    if (!profile.samples) {
+        return;
+    }
+
+    sorted = g_ptr_array_sized_new(g_hash_table_size(profile.entries));
+    g_hash_table_iter_init(&iter, profile.entries);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&e, NULL)) {
+        g_ptr_array_add(sorted, e);
+    }
+    g_ptr_array_sort(sorted, profile_entry_cmp);
+
+    g_string_append_printf(buf, "\n   samples       %%           cycles"
+                           "  location\n");
+    for (unsigned i = 0; i < sorted->len && i < TCG_PROFILE_DUMP_MAX; i++) {
+        profile_dump_entry(buf, g_ptr_array_index(sorted, i));
+    }
+}
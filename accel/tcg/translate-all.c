@@ -316,8 +316,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     assert_no_pages_locked();
     tb = tcg_tb_alloc(tcg_ctx);
     if (unlikely(!tb)) {
-        /* flush must be done */
-        tb_flush(cpu);
+        /* flush or eviction must be done */
+        tb_evict(cpu);
         mmap_unlock();
         /* Make the execution loop process the flush as soon as possible.  */
         cpu->exception_index = EXCP_INTERRUPT;
@@ -662,13 +662,22 @@ void cpu_interrupt(CPUState *cpu, int mask)
 void tcg_flush_jmp_cache(CPUState *cpu)
 {
     CPUJumpCache *jc = cpu->tb_jmp_cache;
+    CPUJumpCacheTable *l1;
 
     /* During early initialization, the cache may not yet be allocated. */
     if (unlikely(jc == NULL)) {
         return;
     }
 
-    for (int i = 0; i < TB_JMP_CACHE_SIZE; i++) {
-        qatomic_set(&jc->array[i].tb, NULL);
+    /* The first level may be resized concurrently by its owner. */
+    RCU_READ_LOCK_GUARD();
+    l1 = qatomic_rcu_read(&jc->l1);
+    for (int i = 0, n = 1 << l1->bits; i < n; i++) {
+        qatomic_set(&l1->array[i].tb, NULL);
+    }
+    if (jc->l2_bits) {
+        for (int i = 0, n = jc->l2_ways << jc->l2_bits; i < n; i++) {
+            qatomic_set(&jc->l2[i].tb, NULL);
+        }
     }
 }
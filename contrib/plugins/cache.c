@@ -17,30 +17,30 @@ QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
 
 static enum qemu_plugin_mem_rw rw = QEMU_PLUGIN_MEM_RW;
 
+/*
+ * miss_ht maps an instruction address to its InsnData so that retranslated
+ * instructions share one entry. It is only consulted at translation time
+ * (and, with buffer=on, the first time a vCPU sees a given pc).
+ */
 static GHashTable *miss_ht;
+static GPtrArray *insns;
 
 static GMutex hashtable_lock;
-static GRand *rng;
 
 static int limit;
 static bool sys;
-
-enum EvictionPolicy {
-    LRU,
-    FIFO,
-    RAND,
-};
-
-enum EvictionPolicy policy;
+static bool use_buffer;
+static struct qemu_plugin_mem_buffer *mem_buffer;
 
 /*
  * A CacheSet is a set of cache blocks. A memory block that maps to a set can be
  * put in any of the blocks inside the set. The number of block per set is
  * called the associativity (assoc).
  *
- * Each block contains the stored tag and a valid bit. Since this is not
- * a functional simulator, the data itself is not stored. We only identify
- * whether a block is in the cache or not by searching for its tag.
+ * Each block is represented by its stored tag, or INVALID_TAG when it holds
+ * nothing. Since this is not a functional simulator, the data itself is not
+ * stored. We only identify whether a block is in the cache or not by searching
+ * for its tag.
  *
  * In order to search for memory data in the cache, the set identifier and tag
  * are extracted from the address and the set is probed to see whether a tag
@@ -56,18 +56,27 @@ enum EvictionPolicy policy;
  * The CacheSet also contains bookkeaping information about eviction details.
  */
 
-typedef struct {
-    uint64_t tag;
-    bool valid;
-} CacheBlock;
+/* The block offset bits of a tag are always clear, see bad_cache_params() */
+#define INVALID_TAG UINT64_MAX
+
+/* Upper bound on the number of locks of a cache shared between vCPUs */
+#define CACHE_LOCK_STRIPES 64
 
 typedef struct {
-    CacheBlock *blocks;
+    uint64_t *tags;
     uint64_t *lru_priorities;
     uint64_t lru_gen_counter;
     GQueue *fifo_queue;
+    uint32_t rand_state;
 } CacheSet;
 
+typedef struct EvictionPolicy EvictionPolicy;
+
+/*
+ * A cache that can be reached from more than one vCPU thread has one lock
+ * per group of sets (set % n_locks), so that accesses to different sets do
+ * not serialize. Caches private to a single vCPU have no locks at all.
+ */
 typedef struct {
     CacheSet *sets;
     int num_sets;
@@ -76,42 +85,83 @@ typedef struct {
     int blksize_shift;
     uint64_t set_mask;
     uint64_t tag_mask;
-    uint64_t accesses;
-    uint64_t misses;
+    const EvictionPolicy *policy;
+    GMutex *locks;
+    int n_locks;
 } Cache;
 
+/**
+ * struct EvictionPolicy - a block replacement policy
+ * @name: value of the evict= option selecting the policy
+ * @init: allocate the per-set bookkeeping of @cache, may be NULL
+ * @destroy: free what @init allocated, may be NULL
+ * @update_hit: account for a hit on a block, may be NULL
+ * @update_miss: account for a block being (re)filled, may be NULL
+ * @victim: pick the block to evict from a full set
+ *
+ * The hooks are always called with the set locked, or on a private cache,
+ * and so need no synchronization of their own.
+ */
+struct EvictionPolicy {
+    const char *name;
+    void (*init)(Cache *cache);
+    void (*destroy)(Cache *cache);
+    void (*update_hit)(Cache *cache, int set, int blk);
+    void (*update_miss)(Cache *cache, int set, int blk);
+    int (*victim)(Cache *cache, int set);
+};
+
 typedef struct {
     char *disas_str;
     const char *symbol;
     uint64_t addr;
+    unsigned int id;
+    /* summed over all vCPUs at exit, see sum_insn_misses() */
     uint64_t l1_dmisses;
     uint64_t l1_imisses;
     uint64_t l2_misses;
 } InsnData;
 
-void (*update_hit)(Cache *cache, int set, int blk);
-void (*update_miss)(Cache *cache, int set, int blk);
+typedef struct {
+    uint64_t l1_dmisses;
+    uint64_t l1_imisses;
+    uint64_t l2_misses;
+} InsnMisses;
+
+typedef struct {
+    uint64_t accesses;
+    uint64_t misses;
+} CacheStats;
+
+typedef struct {
+    CacheStats l1d;
+    CacheStats l1i;
+    CacheStats l2;
+    uint64_t invalidations;
+} CoreStats;
+
+/*
+ * Everything a vCPU counts lives in its own scoreboard entry, so the only
+ * state shared between vCPU threads on the hot path is the cache models.
+ */
+typedef struct {
+    CoreStats stats;
+    GArray *insn_misses;        /* InsnMisses, indexed by InsnData.id */
+    GHashTable *insn_by_pc;     /* buffer=on: vCPU local cache of miss_ht */
+} VCPUData;
+
+static struct qemu_plugin_scoreboard *vcpu_data;
 
-void (*metadata_init)(Cache *cache);
-void (*metadata_destroy)(Cache *cache);
+static const EvictionPolicy *policy;
 
 static int cores;
 static Cache **l1_dcaches, **l1_icaches;
 
 static bool use_l2;
+static bool l2_shared;
 static Cache **l2_ucaches;
 
-static GMutex *l1_dcache_locks;
-static GMutex *l1_icache_locks;
-static GMutex *l2_ucache_locks;
-
-static uint64_t l1_dmem_accesses;
-static uint64_t l1_imem_accesses;
-static uint64_t l1_imisses;
-static uint64_t l1_dmisses;
-
-static uint64_t l2_mem_accesses;
-static uint64_t l2_misses;
+static bool coherence;
 
 static int pow_of_two(int num)
 {
@@ -123,6 +173,16 @@ static int pow_of_two(int num)
     return ret;
 }
 
+static inline uint64_t block_tag(Cache *cache, int set, int blk)
+{
+    return __atomic_load_n(&cache->sets[set].tags[blk], __ATOMIC_RELAXED);
+}
+
+static inline void block_set_tag(Cache *cache, int set, int blk, uint64_t tag)
+{
+    __atomic_store_n(&cache->sets[set].tags[blk], tag, __ATOMIC_RELAXED);
+}
+
 /*
  * LRU evection policy: For each set, a generation counter is maintained
  * alongside a priority array.
@@ -156,7 +216,8 @@ static void lru_update_blk(Cache *cache, int set_idx, int blk_idx)
 
 static int lru_get_lru_block(Cache *cache, int set_idx)
 {
-    int i, min_idx, min_priority;
+    int i, min_idx;
+    uint64_t min_priority;
 
     min_priority = cache->sets[set_idx].lru_priorities[0];
     min_idx = 0;
@@ -208,6 +269,9 @@ static int fifo_get_first_block(Cache *cache, int set)
 static void fifo_update_on_miss(Cache *cache, int set, int blk_idx)
 {
     GQueue *q = cache->sets[set].fifo_queue;
+
+    /* a block invalidated by coherence=on is refilled while still queued */
+    g_queue_remove(q, GINT_TO_POINTER(blk_idx));
     g_queue_push_head(q, GINT_TO_POINTER(blk_idx));
 }
 
@@ -220,6 +284,53 @@ static void fifo_destroy(Cache *cache)
     }
 }
 
+/*
+ * Random eviction policy: each set carries its own xorshift32 state, so
+ * that picking a victim only touches the (locked) set.
+ */
+
+static void rand_init(Cache *cache)
+{
+    int i;
+
+    for (i = 0; i < cache->num_sets; i++) {
+        cache->sets[i].rand_state = g_random_int() | 1;
+    }
+}
+
+static int rand_get_block(Cache *cache, int set)
+{
+    uint32_t x = cache->sets[set].rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cache->sets[set].rand_state = x;
+
+    return x % cache->assoc;
+}
+
+static const EvictionPolicy policies[] = {
+    {
+        .name = "lru",
+        .init = lru_priorities_init,
+        .destroy = lru_priorities_destroy,
+        .update_hit = lru_update_blk,
+        .update_miss = lru_update_blk,
+        .victim = lru_get_lru_block,
+    }, {
+        .name = "fifo",
+        .init = fifo_init,
+        .destroy = fifo_destroy,
+        .update_miss = fifo_update_on_miss,
+        .victim = fifo_get_first_block,
+    }, {
+        .name = "rand",
+        .init = rand_init,
+        .victim = rand_get_block,
+    },
+};
+
 static inline uint64_t extract_tag(Cache *cache, uint64_t addr)
 {
     return addr & cache->tag_mask;
@@ -232,7 +343,9 @@ static inline uint64_t extract_set(Cache *cache, uint64_t addr)
 
 static const char *cache_config_error(int blksize, int assoc, int cachesize)
 {
-    if (cachesize % blksize != 0) {
+    if (blksize < 2) {
+        return "block size must be at least 2 bytes";
+    } else if (cachesize % blksize != 0) {
         return "cache size must be divisible by block size";
     } else if (cachesize % (blksize * assoc) != 0) {
         return "cache size must be divisible by set size (assoc * block size)";
@@ -243,13 +356,14 @@ static const char *cache_config_error(int blksize, int assoc, int cachesize)
 
 static bool bad_cache_params(int blksize, int assoc, int cachesize)
 {
-    return (cachesize % blksize) != 0 || (cachesize % (blksize * assoc) != 0);
+    return blksize < 2 || (cachesize % blksize) != 0 ||
+           (cachesize % (blksize * assoc) != 0);
 }
 
-static Cache *cache_init(int blksize, int assoc, int cachesize)
+static Cache *cache_init(int blksize, int assoc, int cachesize, bool shared)
 {
     Cache *cache;
-    int i;
+    int i, j;
     uint64_t blk_mask;
 
     /*
@@ -262,27 +376,38 @@ static Cache *cache_init(int blksize, int assoc, int cachesize)
     cache->assoc = assoc;
     cache->cachesize = cachesize;
     cache->num_sets = cachesize / (blksize * assoc);
-    cache->sets = g_new(CacheSet, cache->num_sets);
+    cache->sets = g_new0(CacheSet, cache->num_sets);
     cache->blksize_shift = pow_of_two(blksize);
-    cache->accesses = 0;
-    cache->misses = 0;
+    cache->policy = policy;
 
     for (i = 0; i < cache->num_sets; i++) {
-        cache->sets[i].blocks = g_new0(CacheBlock, assoc);
+        cache->sets[i].tags = g_new(uint64_t, assoc);
+        for (j = 0; j < assoc; j++) {
+            cache->sets[i].tags[j] = INVALID_TAG;
+        }
+    }
+
+    if (shared) {
+        cache->n_locks = MIN(cache->num_sets, CACHE_LOCK_STRIPES);
+        cache->locks = g_new0(GMutex, cache->n_locks);
+    } else {
+        cache->n_locks = 0;
+        cache->locks = NULL;
     }
 
     blk_mask = blksize - 1;
     cache->set_mask = ((cache->num_sets - 1) << cache->blksize_shift);
     cache->tag_mask = ~(cache->set_mask | blk_mask);
 
-    if (metadata_init) {
-        metadata_init(cache);
+    if (cache->policy->init) {
+        cache->policy->init(cache);
     }
 
     return cache;
 }
 
-static Cache **caches_init(int blksize, int assoc, int cachesize)
+static Cache **caches_init(int blksize, int assoc, int cachesize, int n,
+                           bool shared)
 {
     Cache **caches;
     int i;
@@ -291,10 +416,10 @@ static Cache **caches_init(int blksize, int assoc, int cachesize)
         return NULL;
     }
 
-    caches = g_new(Cache *, cores);
+    caches = g_new(Cache *, n);
 
-    for (i = 0; i < cores; i++) {
-        caches[i] = cache_init(blksize, assoc, cachesize);
+    for (i = 0; i < n; i++) {
+        caches[i] = cache_init(blksize, assoc, cachesize, shared);
     }
 
     return caches;
@@ -305,7 +430,7 @@ static int get_invalid_block(Cache *cache, uint64_t set)
     int i;
 
     for (i = 0; i < cache->assoc; i++) {
-        if (!cache->sets[set].blocks[i].valid) {
+        if (block_tag(cache, set, i) == INVALID_TAG) {
             return i;
         }
     }
@@ -313,31 +438,12 @@ static int get_invalid_block(Cache *cache, uint64_t set)
     return -1;
 }
 
-static int get_replaced_block(Cache *cache, int set)
-{
-    switch (policy) {
-    case RAND:
-        return g_rand_int_range(rng, 0, cache->assoc);
-    case LRU:
-        return lru_get_lru_block(cache, set);
-    case FIFO:
-        return fifo_get_first_block(cache, set);
-    default:
-        g_assert_not_reached();
-    }
-}
-
-static int in_cache(Cache *cache, uint64_t addr)
+static int in_cache(Cache *cache, uint64_t set, uint64_t tag)
 {
     int i;
-    uint64_t tag, set;
-
-    tag = extract_tag(cache, addr);
-    set = extract_set(cache, addr);
 
     for (i = 0; i < cache->assoc; i++) {
-        if (cache->sets[set].blocks[i].tag == tag &&
-                cache->sets[set].blocks[i].valid) {
+        if (block_tag(cache, set, i) == tag) {
             return i;
         }
     }
@@ -355,34 +461,130 @@ static int in_cache(Cache *cache, uint64_t addr)
  */
 static bool access_cache(Cache *cache, uint64_t addr)
 {
+    const EvictionPolicy *p = cache->policy;
     int hit_blk, replaced_blk;
     uint64_t tag, set;
+    GMutex *lock = NULL;
 
     tag = extract_tag(cache, addr);
     set = extract_set(cache, addr);
 
-    hit_blk = in_cache(cache, addr);
+    if (cache->locks) {
+        lock = &cache->locks[set % cache->n_locks];
+        g_mutex_lock(lock);
+    }
+
+    hit_blk = in_cache(cache, set, tag);
     if (hit_blk != -1) {
-        if (update_hit) {
-            update_hit(cache, set, hit_blk);
+        if (p->update_hit) {
+            p->update_hit(cache, set, hit_blk);
+        }
+    } else {
+        replaced_blk = get_invalid_block(cache, set);
+
+        if (replaced_blk == -1) {
+            replaced_blk = p->victim(cache, set);
+        }
+
+        if (p->update_miss) {
+            p->update_miss(cache, set, replaced_blk);
+        }
+
+        block_set_tag(cache, set, replaced_blk, tag);
+    }
+
+    if (lock) {
+        g_mutex_unlock(lock);
+    }
+
+    return hit_blk != -1;
+}
+
+/*
+ * With coherence=on the L1 data caches are kept coherent with a
+ * MESI-lite write-invalidate protocol: a line is either present (Shared,
+ * or Modified once written) or Invalid, there is no Exclusive state and
+ * no write-back traffic is modelled. A store drops the line from the L1
+ * of every other core.
+ *
+ * The other caches may be in use by their own vCPU threads without any
+ * lock, so a line is only invalidated with a compare-and-swap that fails
+ * if it has meanwhile been refilled with another address.
+ */
+static uint64_t invalidate_other_l1(int core, uint64_t addr)
+{
+    uint64_t n = 0;
+    int i, blk;
+
+    for (i = 0; i < cores; i++) {
+        Cache *cache = l1_dcaches[i];
+        uint64_t tag, set;
+
+        if (i == core) {
+            continue;
+        }
+
+        tag = extract_tag(cache, addr);
+        set = extract_set(cache, addr);
+        for (blk = 0; blk < cache->assoc; blk++) {
+            uint64_t expected = tag;
+
+            if (block_tag(cache, set, blk) == tag &&
+                __atomic_compare_exchange_n(&cache->sets[set].tags[blk],
+                                            &expected, INVALID_TAG, false,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                n++;
+                break;
+            }
         }
-        return true;
     }
 
-    replaced_blk = get_invalid_block(cache, set);
+    return n;
+}
+
+static inline Cache *l2_cache(int core)
+{
+    return l2_ucaches[l2_shared ? 0 : core];
+}
 
-    if (replaced_blk == -1) {
-        replaced_blk = get_replaced_block(cache, set);
+static InsnMisses *insn_misses(VCPUData *vcpu, InsnData *insn)
+{
+    if (!vcpu->insn_misses) {
+        vcpu->insn_misses = g_array_new(false, true, sizeof(InsnMisses));
+    }
+    if (insn->id >= vcpu->insn_misses->len) {
+        g_array_set_size(vcpu->insn_misses, insn->id + 1);
     }
+    return &g_array_index(vcpu->insn_misses, InsnMisses, insn->id);
+}
 
-    if (update_miss) {
-        update_miss(cache, set, replaced_blk);
+static void dcache_access(unsigned int vcpu_index, uint64_t effective_addr,
+                          bool is_store, InsnData *insn)
+{
+    VCPUData *vcpu = qemu_plugin_scoreboard_find(vcpu_data, vcpu_index);
+    int core = vcpu_index % cores;
+
+    if (coherence && is_store) {
+        vcpu->stats.invalidations += invalidate_other_l1(core, effective_addr);
     }
 
-    cache->sets[set].blocks[replaced_blk].tag = tag;
-    cache->sets[set].blocks[replaced_blk].valid = true;
+    vcpu->stats.l1d.accesses++;
+    if (access_cache(l1_dcaches[core], effective_addr)) {
+        return;
+    }
+    vcpu->stats.l1d.misses++;
+    insn_misses(vcpu, insn)->l1_dmisses++;
 
-    return false;
+    if (!use_l2) {
+        return;
+    }
+
+    vcpu->stats.l2.accesses++;
+    if (!access_cache(l2_cache(core), effective_addr)) {
+        vcpu->stats.l2.misses++;
+        insn_misses(vcpu, insn)->l2_misses++;
+    }
 }
 
 static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
@@ -390,9 +592,6 @@ static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
 {
     uint64_t effective_addr;
     struct qemu_plugin_hwaddr *hwaddr;
-    int cache_idx;
-    InsnData *insn;
-    bool hit_in_l1;
 
     hwaddr = qemu_plugin_get_hwaddr(info, vaddr);
     if (hwaddr && qemu_plugin_hwaddr_is_io(hwaddr)) {
@@ -400,66 +599,76 @@ static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
     }
 
     effective_addr = hwaddr ? qemu_plugin_hwaddr_phys_addr(hwaddr) : vaddr;
-    cache_idx = vcpu_index % cores;
+    dcache_access(vcpu_index, effective_addr,
+                  qemu_plugin_mem_is_store(info), userdata);
+}
 
-    g_mutex_lock(&l1_dcache_locks[cache_idx]);
-    hit_in_l1 = access_cache(l1_dcaches[cache_idx], effective_addr);
-    if (!hit_in_l1) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l1_dmisses, 1, __ATOMIC_SEQ_CST);
-        l1_dcaches[cache_idx]->misses++;
+static InsnData *vcpu_lookup_insn(VCPUData *vcpu, uint64_t pc)
+{
+    InsnData *insn;
+
+    if (!vcpu->insn_by_pc) {
+        vcpu->insn_by_pc = g_hash_table_new(NULL, g_direct_equal);
     }
-    l1_dcaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l1_dcache_locks[cache_idx]);
 
-    if (hit_in_l1 || !use_l2) {
-        /* No need to access L2 */
-        return;
+    insn = g_hash_table_lookup(vcpu->insn_by_pc, GUINT_TO_POINTER(pc));
+    if (!insn) {
+        g_mutex_lock(&hashtable_lock);
+        insn = g_hash_table_lookup(miss_ht, GUINT_TO_POINTER(pc));
+        g_mutex_unlock(&hashtable_lock);
+        g_assert(insn);
+        g_hash_table_insert(vcpu->insn_by_pc, GUINT_TO_POINTER(pc), insn);
     }
 
-    g_mutex_lock(&l2_ucache_locks[cache_idx]);
-    if (!access_cache(l2_ucaches[cache_idx], effective_addr)) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_SEQ_CST);
-        l2_ucaches[cache_idx]->misses++;
+    return insn;
+}
+
+/*
+ * With buffer=on the data accesses of a vCPU are delivered in batches.
+ * The hardware address cannot be queried after the fact, so virtual
+ * addresses are simulated, and the instruction is found from its pc.
+ */
+static void vcpu_mem_buffer_flush(unsigned int vcpu_index,
+                                  const struct qemu_plugin_mem_record *records,
+                                  size_t n, void *userdata)
+{
+    VCPUData *vcpu = qemu_plugin_scoreboard_find(vcpu_data, vcpu_index);
+    InsnData *insn = NULL;
+    uint64_t insn_pc = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        if (!insn || records[i].pc != insn_pc) {
+            insn_pc = records[i].pc;
+            insn = vcpu_lookup_insn(vcpu, insn_pc);
+        }
+        dcache_access(vcpu_index, records[i].vaddr,
+                      qemu_plugin_mem_is_store(records[i].info), insn);
     }
-    l2_ucaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
 }
 
 static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
 {
-    uint64_t insn_addr;
-    InsnData *insn;
-    int cache_idx;
-    bool hit_in_l1;
+    VCPUData *vcpu = qemu_plugin_scoreboard_find(vcpu_data, vcpu_index);
+    InsnData *insn = userdata;
+    int core = vcpu_index % cores;
 
-    insn_addr = ((InsnData *) userdata)->addr;
-
-    cache_idx = vcpu_index % cores;
-    g_mutex_lock(&l1_icache_locks[cache_idx]);
-    hit_in_l1 = access_cache(l1_icaches[cache_idx], insn_addr);
-    if (!hit_in_l1) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l1_imisses, 1, __ATOMIC_SEQ_CST);
-        l1_icaches[cache_idx]->misses++;
+    vcpu->stats.l1i.accesses++;
+    if (access_cache(l1_icaches[core], insn->addr)) {
+        return;
     }
-    l1_icaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l1_icache_locks[cache_idx]);
+    vcpu->stats.l1i.misses++;
+    insn_misses(vcpu, insn)->l1_imisses++;
 
-    if (hit_in_l1 || !use_l2) {
-        /* No need to access L2 */
+    if (!use_l2) {
         return;
     }
 
-    g_mutex_lock(&l2_ucache_locks[cache_idx]);
-    if (!access_cache(l2_ucaches[cache_idx], insn_addr)) {
-        insn = userdata;
-        __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_SEQ_CST);
-        l2_ucaches[cache_idx]->misses++;
+    vcpu->stats.l2.accesses++;
+    if (!access_cache(l2_cache(core), insn->addr)) {
+        vcpu->stats.l2.misses++;
+        insn_misses(vcpu, insn)->l2_misses++;
     }
-    l2_ucaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
 }
 
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
@@ -472,12 +681,15 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
     for (i = 0; i < n_insns; i++) {
         struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
         uint64_t effective_addr;
+        uint64_t key;
 
         if (sys) {
             effective_addr = (uint64_t) qemu_plugin_insn_haddr(insn);
         } else {
             effective_addr = (uint64_t) qemu_plugin_insn_vaddr(insn);
         }
+        /* buffered records only carry the pc of the instruction */
+        key = use_buffer ? qemu_plugin_insn_vaddr(insn) : effective_addr;
 
         /*
          * Instructions might get translated multiple times, we do not create
@@ -485,20 +697,26 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
          * entry from the hash table and register it for the callback again.
          */
         g_mutex_lock(&hashtable_lock);
-        data = g_hash_table_lookup(miss_ht, GUINT_TO_POINTER(effective_addr));
+        data = g_hash_table_lookup(miss_ht, GUINT_TO_POINTER(key));
         if (data == NULL) {
             data = g_new0(InsnData, 1);
             data->disas_str = qemu_plugin_insn_disas(insn);
             data->symbol = qemu_plugin_insn_symbol(insn);
             data->addr = effective_addr;
-            g_hash_table_insert(miss_ht, GUINT_TO_POINTER(effective_addr),
+            data->id = insns->len;
+            g_ptr_array_add(insns, data);
+            g_hash_table_insert(miss_ht, GUINT_TO_POINTER(key),
                                (gpointer) data);
         }
         g_mutex_unlock(&hashtable_lock);
 
-        qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem_access,
-                                         QEMU_PLUGIN_CB_NO_REGS,
-                                         rw, data);
+        if (use_buffer) {
+            qemu_plugin_register_vcpu_mem_buffer(insn, rw, mem_buffer);
+        } else {
+            qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem_access,
+                                             QEMU_PLUGIN_CB_NO_REGS,
+                                             rw, data);
+        }
 
         qemu_plugin_register_vcpu_insn_exec_cb(insn, vcpu_insn_exec,
                                                QEMU_PLUGIN_CB_NO_REGS, data);
@@ -515,69 +733,89 @@ static void insn_free(gpointer data)
 static void cache_free(Cache *cache)
 {
     for (int i = 0; i < cache->num_sets; i++) {
-        g_free(cache->sets[i].blocks);
+        g_free(cache->sets[i].tags);
     }
 
-    if (metadata_destroy) {
-        metadata_destroy(cache);
+    if (cache->policy->destroy) {
+        cache->policy->destroy(cache);
     }
 
+    g_free(cache->locks);
     g_free(cache->sets);
     g_free(cache);
 }
 
-static void caches_free(Cache **caches)
+static void caches_free(Cache **caches, int n)
 {
     int i;
 
-    for (i = 0; i < cores; i++) {
+    for (i = 0; i < n; i++) {
         cache_free(caches[i]);
     }
+    g_free(caches);
 }
 
-static void append_stats_line(GString *line,
-                              uint64_t l1_daccess, uint64_t l1_dmisses,
-                              uint64_t l1_iaccess, uint64_t l1_imisses,
-                              uint64_t l2_access, uint64_t l2_misses)
+static void append_stats_line(GString *line, const CoreStats *stats)
 {
-    double l1_dmiss_rate = ((double) l1_dmisses) / (l1_daccess) * 100.0;
-    double l1_imiss_rate = ((double) l1_imisses) / (l1_iaccess) * 100.0;
+    const CacheStats *l1d = &stats->l1d, *l1i = &stats->l1i;
+    double l1_dmiss_rate = ((double) l1d->misses) / (l1d->accesses) * 100.0;
+    double l1_imiss_rate = ((double) l1i->misses) / (l1i->accesses) * 100.0;
 
     g_string_append_printf(line, "%-14" PRIu64 " %-12" PRIu64 " %9.4lf%%"
                            "  %-14" PRIu64 " %-12" PRIu64 " %9.4lf%%",
-                           l1_daccess,
-                           l1_dmisses,
-                           l1_daccess ? l1_dmiss_rate : 0.0,
-                           l1_iaccess,
-                           l1_imisses,
-                           l1_iaccess ? l1_imiss_rate : 0.0);
-
-    if (l2_access && l2_misses) {
-        double l2_miss_rate =  ((double) l2_misses) / (l2_access) * 100.0;
+                           l1d->accesses,
+                           l1d->misses,
+                           l1d->accesses ? l1_dmiss_rate : 0.0,
+                           l1i->accesses,
+                           l1i->misses,
+                           l1i->accesses ? l1_imiss_rate : 0.0);
+
+    if (use_l2) {
+        const CacheStats *l2 = &stats->l2;
+        double l2_miss_rate =  ((double) l2->misses) / (l2->accesses) * 100.0;
         g_string_append_printf(line,
                                "  %-12" PRIu64 " %-11" PRIu64 " %10.4lf%%",
-                               l2_access,
-                               l2_misses,
-                               l2_access ? l2_miss_rate : 0.0);
+                               l2->accesses,
+                               l2->misses,
+                               l2->accesses ? l2_miss_rate : 0.0);
+    }
+
+    if (coherence) {
+        g_string_append_printf(line, "  %-13" PRIu64, stats->invalidations);
     }
 
     g_string_append(line, "\n");
 }
 
-static void sum_stats(void)
+static void core_stats_add(CoreStats *sum, const CoreStats *stats)
+{
+    sum->l1d.accesses += stats->l1d.accesses;
+    sum->l1d.misses += stats->l1d.misses;
+    sum->l1i.accesses += stats->l1i.accesses;
+    sum->l1i.misses += stats->l1i.misses;
+    sum->l2.accesses += stats->l2.accesses;
+    sum->l2.misses += stats->l2.misses;
+    sum->invalidations += stats->invalidations;
+}
+
+static void sum_insn_misses(void)
 {
     int i;
+    guint j;
 
-    g_assert(cores > 1);
-    for (i = 0; i < cores; i++) {
-        l1_imisses += l1_icaches[i]->misses;
-        l1_dmisses += l1_dcaches[i]->misses;
-        l1_imem_accesses += l1_icaches[i]->accesses;
-        l1_dmem_accesses += l1_dcaches[i]->accesses;
-
-        if (use_l2) {
-            l2_misses += l2_ucaches[i]->misses;
-            l2_mem_accesses += l2_ucaches[i]->accesses;
+    for (i = 0; i < qemu_plugin_num_vcpus(); i++) {
+        VCPUData *vcpu = qemu_plugin_scoreboard_find(vcpu_data, i);
+
+        if (!vcpu->insn_misses) {
+            continue;
+        }
+        for (j = 0; j < vcpu->insn_misses->len; j++) {
+            InsnMisses *m = &g_array_index(vcpu->insn_misses, InsnMisses, j);
+            InsnData *insn = g_ptr_array_index(insns, j);
+
+            insn->l1_dmisses += m->l1_dmisses;
+            insn->l1_imisses += m->l1_imisses;
+            insn->l2_misses += m->l2_misses;
         }
     }
 }
@@ -606,10 +844,15 @@ static int l2_cmp(gconstpointer a, gconstpointer b)
     return insn_a->l2_misses < insn_b->l2_misses ? 1 : -1;
 }
 
+/*
+ * vCPUs are mapped to cores round-robin, the statistics of a core are
+ * those of all the vCPUs running on it.
+ */
 static void log_stats(void)
 {
     int i;
-    Cache *icache, *dcache, *l2_cache;
+    g_autofree CoreStats *core_stats = g_new0(CoreStats, cores);
+    CoreStats sum = { 0 };
 
     g_autoptr(GString) rep = g_string_new("core #, data accesses, data misses,"
                                           " dmiss rate, insn accesses,"
@@ -619,25 +862,27 @@ static void log_stats(void)
         g_string_append(rep, ", l2 accesses, l2 misses, l2 miss rate");
     }
 
+    if (coherence) {
+        g_string_append(rep, ", invalidations");
+    }
+
     g_string_append(rep, "\n");
 
+    for (i = 0; i < qemu_plugin_num_vcpus(); i++) {
+        VCPUData *vcpu = qemu_plugin_scoreboard_find(vcpu_data, i);
+
+        core_stats_add(&core_stats[i % cores], &vcpu->stats);
+        core_stats_add(&sum, &vcpu->stats);
+    }
+
     for (i = 0; i < cores; i++) {
         g_string_append_printf(rep, "%-8d", i);
-        dcache = l1_dcaches[i];
-        icache = l1_icaches[i];
-        l2_cache = use_l2 ? l2_ucaches[i] : NULL;
-        append_stats_line(rep, dcache->accesses, dcache->misses,
-                icache->accesses, icache->misses,
-                l2_cache ? l2_cache->accesses : 0,
-                l2_cache ? l2_cache->misses : 0);
+        append_stats_line(rep, &core_stats[i]);
     }
 
     if (cores > 1) {
-        sum_stats();
         g_string_append_printf(rep, "%-8s", "sum");
-        append_stats_line(rep, l1_dmem_accesses, l1_dmisses,
-                l1_imem_accesses, l1_imisses,
-                l2_cache ? l2_mem_accesses : 0, l2_cache ? l2_misses : 0);
+        append_stats_line(rep, &sum);
     }
 
     g_string_append(rep, "\n");
@@ -650,6 +895,8 @@ static void log_top_insns(void)
     GList *curr, *miss_insns;
     InsnData *insn;
 
+    sum_insn_misses();
+
     miss_insns = g_hash_table_get_values(miss_ht);
     miss_insns = g_list_sort(miss_insns, dcmp);
     g_autoptr(GString) rep = g_string_new("");
@@ -700,45 +947,55 @@ finish:
     g_list_free(miss_insns);
 }
 
+static void vcpu_data_free(void)
+{
+    int i;
+
+    for (i = 0; i < qemu_plugin_num_vcpus(); i++) {
+        VCPUData *vcpu = qemu_plugin_scoreboard_find(vcpu_data, i);
+
+        if (vcpu->insn_misses) {
+            g_array_free(vcpu->insn_misses, true);
+        }
+        if (vcpu->insn_by_pc) {
+            g_hash_table_destroy(vcpu->insn_by_pc);
+        }
+    }
+    qemu_plugin_scoreboard_free(vcpu_data);
+}
+
 static void plugin_exit(qemu_plugin_id_t id, void *p)
 {
+    if (use_buffer) {
+        qemu_plugin_mem_buffer_flush(mem_buffer);
+        qemu_plugin_mem_buffer_free(mem_buffer);
+    }
+
     log_stats();
     log_top_insns();
 
-    caches_free(l1_dcaches);
-    caches_free(l1_icaches);
-
-    g_free(l1_dcache_locks);
-    g_free(l1_icache_locks);
+    caches_free(l1_dcaches, cores);
+    caches_free(l1_icaches, cores);
 
     if (use_l2) {
-        caches_free(l2_ucaches);
-        g_free(l2_ucache_locks);
+        caches_free(l2_ucaches, l2_shared ? 1 : cores);
     }
 
+    vcpu_data_free();
     g_hash_table_destroy(miss_ht);
+    g_ptr_array_free(insns, true);
 }
 
-static void policy_init(void)
+static const EvictionPolicy *policy_lookup(const char *name)
 {
-    switch (policy) {
-    case LRU:
-        update_hit = lru_update_blk;
-        update_miss = lru_update_blk;
-        metadata_init = lru_priorities_init;
-        metadata_destroy = lru_priorities_destroy;
-        break;
-    case FIFO:
-        update_miss = fifo_update_on_miss;
-        metadata_init = fifo_init;
-        metadata_destroy = fifo_destroy;
-        break;
-    case RAND:
-        rng = g_rand_new();
-        break;
-    default:
-        g_assert_not_reached();
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(policies); i++) {
+        if (g_strcmp0(policies[i].name, name) == 0) {
+            return &policies[i];
+        }
     }
+    return NULL;
 }
 
 QEMU_PLUGIN_EXPORT
@@ -749,6 +1006,7 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
     int l1_iassoc, l1_iblksize, l1_icachesize;
     int l1_dassoc, l1_dblksize, l1_dcachesize;
     int l2_assoc, l2_blksize, l2_cachesize;
+    bool shared_cores;
 
     limit = 32;
     sys = info->system_emulation;
@@ -765,7 +1023,7 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
     l2_blksize = 64;
     l2_cachesize = l2_assoc * l2_blksize * 2048;
 
-    policy = LRU;
+    policy = &policies[0];
 
     cores = sys ? info->system.smp_vcpus : 1;
 
@@ -803,14 +1061,25 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
                 fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
                 return -1;
             }
+        } else if (g_strcmp0(tokens[0], "l2shared") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &l2_shared)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+            use_l2 |= l2_shared;
+        } else if (g_strcmp0(tokens[0], "coherence") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &coherence)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "buffer") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &use_buffer)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
         } else if (g_strcmp0(tokens[0], "evict") == 0) {
-            if (g_strcmp0(tokens[1], "rand") == 0) {
-                policy = RAND;
-            } else if (g_strcmp0(tokens[1], "lru") == 0) {
-                policy = LRU;
-            } else if (g_strcmp0(tokens[1], "fifo") == 0) {
-                policy = FIFO;
-            } else {
+            policy = policy_lookup(tokens[1]);
+            if (!policy) {
                 fprintf(stderr, "invalid eviction policy: %s\n", opt);
                 return -1;
             }
@@ -820,9 +1089,15 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         }
     }
 
-    policy_init();
+    /*
+     * The caches of a core only need locking when more than one vCPU
+     * thread can run on it. In user mode every guest thread is a vCPU,
+     * so their number is not known in advance.
+     */
+    shared_cores = !sys || cores < info->system.max_vcpus;
 
-    l1_dcaches = caches_init(l1_dblksize, l1_dassoc, l1_dcachesize);
+    l1_dcaches = caches_init(l1_dblksize, l1_dassoc, l1_dcachesize, cores,
+                             shared_cores);
     if (!l1_dcaches) {
         const char *err = cache_config_error(l1_dblksize, l1_dassoc, l1_dcachesize);
         fprintf(stderr, "dcache cannot be constructed from given parameters\n");
@@ -830,7 +1105,8 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         return -1;
     }
 
-    l1_icaches = caches_init(l1_iblksize, l1_iassoc, l1_icachesize);
+    l1_icaches = caches_init(l1_iblksize, l1_iassoc, l1_icachesize, cores,
+                             shared_cores);
     if (!l1_icaches) {
         const char *err = cache_config_error(l1_iblksize, l1_iassoc, l1_icachesize);
         fprintf(stderr, "icache cannot be constructed from given parameters\n");
@@ -838,7 +1114,13 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         return -1;
     }
 
-    l2_ucaches = use_l2 ? caches_init(l2_blksize, l2_assoc, l2_cachesize) : NULL;
+    if (use_l2 && l2_shared) {
+        l2_ucaches = caches_init(l2_blksize, l2_assoc, l2_cachesize, 1,
+                                 shared_cores || cores > 1);
+    } else if (use_l2) {
+        l2_ucaches = caches_init(l2_blksize, l2_assoc, l2_cachesize, cores,
+                                 shared_cores);
+    }
     if (!l2_ucaches && use_l2) {
         const char *err = cache_config_error(l2_blksize, l2_assoc, l2_cachesize);
         fprintf(stderr, "L2 cache cannot be constructed from given parameters\n");
@@ -846,14 +1128,18 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         return -1;
     }
 
-    l1_dcache_locks = g_new0(GMutex, cores);
-    l1_icache_locks = g_new0(GMutex, cores);
-    l2_ucache_locks = use_l2 ? g_new0(GMutex, cores) : NULL;
+    if (use_buffer) {
+        mem_buffer = qemu_plugin_mem_buffer_new(8192, vcpu_mem_buffer_flush,
+                                                NULL);
+    }
+
+    vcpu_data = qemu_plugin_scoreboard_new(sizeof(VCPUData));
 
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
     qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
 
-    miss_ht = g_hash_table_new_full(NULL, g_direct_equal, NULL, insn_free);
+    miss_ht = g_hash_table_new(NULL, g_direct_equal);
+    insns = g_ptr_array_new_with_free_func(insn_free);
 
     return 0;
 }
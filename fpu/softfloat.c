@@ -3088,11 +3088,39 @@ int16_t float32_to_int16_scalbn(float32 a, FloatRoundMode rmode, int scale,
     return parts_float_to_sint(&p, rmode, scale, INT16_MIN, INT16_MAX, s);
 }
 
+/*
+ * Truncation, or rounding to nearest-even in the host's default mode, of
+ * a zero or normal input with a result in range can only raise inexact.
+ * With inexact already set, the host conversion is then exact.
+ */
+static inline bool can_use_fpu_to_int(FloatRoundMode rmode, int scale,
+                                      const float_status *s)
+{
+    if (QEMU_NO_HARDFLOAT || scale != 0) {
+        return false;
+    }
+    return likely(s->float_exception_flags & float_flag_inexact) &&
+           (rmode == float_round_to_zero ||
+            rmode == float_round_nearest_even);
+}
+
 int32_t float32_to_int32_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
     FloatParts64 p;
 
+    if (can_use_fpu_to_int(rmode, scale, s) &&
+        float32_is_zero_or_normal(a)) {
+        union_float32 ua;
+        float r;
+
+        ua.s = a;
+        r = rmode == float_round_to_zero ? truncf(ua.h) : rintf(ua.h);
+        if (r >= -0x1p31 && r < 0x1p31) {
+            return r;
+        }
+    }
+
     float32_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT32_MIN, INT32_MAX, s);
 }
@@ -3102,6 +3130,18 @@ int64_t float32_to_int64_scalbn(float32 a, FloatRoundMode rmode, int scale,
 {
     FloatParts64 p;
 
+    if (can_use_fpu_to_int(rmode, scale, s) &&
+        float32_is_zero_or_normal(a)) {
+        union_float32 ua;
+        float r;
+
+        ua.s = a;
+        r = rmode == float_round_to_zero ? truncf(ua.h) : rintf(ua.h);
+        if (r >= -0x1p63 && r < 0x1p63) {
+            return r;
+        }
+    }
+
     float32_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT64_MIN, INT64_MAX, s);
 }
@@ -3120,6 +3160,18 @@ int32_t float64_to_int32_scalbn(float64 a, FloatRoundMode rmode, int scale,
 {
     FloatParts64 p;
 
+    if (can_use_fpu_to_int(rmode, scale, s) &&
+        float64_is_zero_or_normal(a)) {
+        union_float64 ua;
+        double r;
+
+        ua.s = a;
+        r = rmode == float_round_to_zero ? trunc(ua.h) : rint(ua.h);
+        if (r >= -0x1p31 && r < 0x1p31) {
+            return r;
+        }
+    }
+
     float64_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT32_MIN, INT32_MAX, s);
 }
@@ -3129,6 +3181,18 @@ int64_t float64_to_int64_scalbn(float64 a, FloatRoundMode rmode, int scale,
 {
     FloatParts64 p;
 
+    if (can_use_fpu_to_int(rmode, scale, s) &&
+        float64_is_zero_or_normal(a)) {
+        union_float64 ua;
+        double r;
+
+        ua.s = a;
+        r = rmode == float_round_to_zero ? trunc(ua.h) : rint(ua.h);
+        if (r >= -0x1p63 && r < 0x1p63) {
+            return r;
+        }
+    }
+
     float64_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT64_MIN, INT64_MAX, s);
 }
@@ -4279,10 +4343,33 @@ static bfloat16 bfloat16_minmax(bfloat16 a, bfloat16 b,
     return bfloat16_round_pack_canonical(pr, s);
 }
 
+/*
+ * Without NaN or denormal operands, min and max raise no exceptions and
+ * all of the variants other than the magnitude ones agree, so the host
+ * can compare.  Equal operands are either identical, or are zeros of
+ * opposite sign, for which the negative one is less.
+ */
+static inline bool can_use_fpu_minmax(int flags)
+{
+    return !QEMU_NO_HARDFLOAT && !(flags & minmax_ismag);
+}
+
 static float32 float32_minmax(float32 a, float32 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
+    if (can_use_fpu_minmax(flags) &&
+        (float32_is_zero_or_normal(a) || float32_is_infinity(a)) &&
+        (float32_is_zero_or_normal(b) || float32_is_infinity(b))) {
+        union_float32 ua, ub;
+        bool a_less;
+
+        ua.s = a;
+        ub.s = b;
+        a_less = ua.h < ub.h || (ua.h == ub.h && float32_is_neg(a));
+        return a_less == !!(flags & minmax_ismin) ? a : b;
+    }
+
     float32_unpack_canonical(&pa, a, s);
     float32_unpack_canonical(&pb, b, s);
     pr = parts_minmax(&pa, &pb, s, flags);
@@ -4294,6 +4381,18 @@ static float64 float64_minmax(float64 a, float64 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
+    if (can_use_fpu_minmax(flags) &&
+        (float64_is_zero_or_normal(a) || float64_is_infinity(a)) &&
+        (float64_is_zero_or_normal(b) || float64_is_infinity(b))) {
+        union_float64 ua, ub;
+        bool a_less;
+
+        ua.s = a;
+        ub.s = b;
+        a_less = ua.h < ub.h || (ua.h == ub.h && float64_is_neg(a));
+        return a_less == !!(flags & minmax_ismin) ? a : b;
+    }
+
     float64_unpack_canonical(&pa, a, s);
     float64_unpack_canonical(&pb, b, s);
     pr = parts_minmax(&pa, &pb, s, flags);
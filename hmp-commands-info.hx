@@ -283,6 +283,21 @@ SRST
     Show dynamic compiler opcode counters
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tcg-profile",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show samples of the TCG profiler",
+    },
+#endif
+
+SRST
+  ``info tcg-profile``
+    Show where vCPU threads spent their time according to the TCG
+    sampling profiler, by guest PC of the translation block.
+ERST
+
     {
         .name       = "sync-profile",
         .args_type  = "mean:-m,no_coalesce:-n,max:i?",
@@ -195,8 +195,15 @@ struct CPUClass {
  */
 #define NB_MMU_MODES 16
 
-/* Use a fully associative victim tlb of 8 entries. */
-#define CPU_VTLB_SIZE 8
+/*
+ * By default, use a fully associative victim tlb of 8 entries.
+ * The size and associativity can be changed with -accel tcg.
+ */
+#define CPU_VTLB_DEFAULT_SIZE 8
+#define CPU_VTLB_MAX_SIZE 1024
+
+/* Remember up to 8 large page translations per mmu mode. */
+#define CPU_LTLB_SIZE 8
 
 /*
  * The full TLB entry, which is not accessed by generated TCG code,
@@ -230,6 +237,16 @@ typedef struct CPUTLBEntryFull {
     /* @lg_page_size contains the log2 of the page size. */
     uint8_t lg_page_size;
 
+    /*
+     * @lg_map_size, if greater than TARGET_PAGE_BITS, is the log2 of the
+     * size of the naturally aligned region containing the page which the
+     * target guarantees is mapped linearly with the same @prot and @attrs.
+     * Unlike @lg_page_size, which may be rounded up so that invalidation
+     * works, this lets the TLB fill other pages of the region without
+     * calling tlb_fill again.  Zero if not known.
+     */
+    uint8_t lg_map_size;
+
     /* Additional tlb flags requested by tlb_fill. */
     uint8_t tlb_fill_flags;
 
@@ -261,6 +278,22 @@ typedef struct CPUTLBEntryFull {
     } extra;
 } CPUTLBEntryFull;
 
+/*
+ * A translation for a region larger than TARGET_PAGE_SIZE, as reported
+ * by tlb_fill via @lg_map_size.  Any TARGET_PAGE_SIZE page within it
+ * can be entered into the TLB without another page table walk.
+ */
+typedef struct CPUTLBLargeEntry {
+    /*
+     * The entry is matched if (addr & @mask) == @addr.
+     * An empty entry has @addr == -1 and @mask == 0.
+     */
+    vaddr addr;
+    vaddr mask;
+    /* @full.phys_addr is the physical address of the start of the page. */
+    CPUTLBEntryFull full;
+} CPUTLBLargeEntry;
+
 /*
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
@@ -281,12 +314,46 @@ typedef struct CPUTLBDesc {
     size_t n_used_entries;
     /* The next index to use in the tlb victim table.  */
     size_t vindex;
-    /* The tlb victim table, in two parts.  */
-    CPUTLBEntry vtable[CPU_VTLB_SIZE];
-    CPUTLBEntryFull vfulltlb[CPU_VTLB_SIZE];
+    /* The geometry of the tlb victim table; both are powers of 2.  */
+    unsigned vsets;
+    unsigned vways;
+    /* The tlb victim table, in two parts, of vsets * vways entries.  */
+    CPUTLBEntry *vtable;
+    CPUTLBEntryFull *vfulltlb;
+    /* Victim tlb statistics, read and written atomically.  */
+    size_t vtlb_hits;
+    size_t vtlb_misses;
     CPUTLBEntryFull *fulltlb;
+    /* The next index to use in the large page table.  */
+    size_t lindex;
+    /* The large page table, consulted before calling tlb_fill.  */
+    CPUTLBLargeEntry ltable[CPU_LTLB_SIZE];
 } CPUTLBDesc;
 
+/* Number of distinct ranges a CPUTLBShootdown holds before escalating. */
+#define CPU_TLB_SHOOTDOWN_RANGES 16
+
+typedef struct CPUTLBShootdownRange {
+    vaddr addr;
+    vaddr len;
+    uint16_t idxmap;
+    uint16_t bits;
+} CPUTLBShootdownRange;
+
+/*
+ * Flushes requested of this cpu by other cpus, coalesced until the
+ * single work item queued to perform them runs.
+ */
+typedef struct CPUTLBShootdown {
+    /* Set of mmu_idx to flush entirely. */
+    uint16_t full_idxmap;
+    /* A plain and/or safe work item is queued to run the batch. */
+    bool queued;
+    bool queued_safe;
+    unsigned n_ranges;
+    CPUTLBShootdownRange range[CPU_TLB_SHOOTDOWN_RANGES];
+} CPUTLBShootdown;
+
 /*
  * Data elements that are shared between all MMU modes.
  */
@@ -299,6 +366,8 @@ typedef struct CPUTLBCommon {
      * Protected by tlb_c.lock.
      */
     uint16_t dirty;
+    /* Pending cross-cpu flushes.  Protected by tlb_c.lock. */
+    CPUTLBShootdown shootdown;
     /*
      * Statistics.  These are not lock protected, but are read and
      * written atomically.  This allows the monitor to print a snapshot
@@ -307,6 +376,10 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t large_fill_count;
+    size_t shootdown_post_count;
+    size_t shootdown_merge_count;
+    size_t shootdown_escalate_count;
 } CPUTLBCommon;
 
 /*
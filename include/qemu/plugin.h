@@ -75,6 +75,8 @@ enum plugin_dyn_cb_subtype {
     PLUGIN_CB_REGULAR,
     PLUGIN_CB_REGULAR_R,
     PLUGIN_CB_INLINE,
+    PLUGIN_CB_COND,
+    PLUGIN_CB_MEM_BUFFER,
     PLUGIN_N_CB_SUBTYPES,
 };
 
@@ -96,6 +98,15 @@ struct qemu_plugin_dyn_cb {
             enum qemu_plugin_op op;
             uint64_t imm;
         } inline_insn;
+        struct {
+            qemu_plugin_u64 entry;
+            enum qemu_plugin_cond cond;
+            uint64_t imm;
+        } cond;
+        struct {
+            struct qemu_plugin_mem_buffer *buf;
+            uint64_t pc;
+        } mem_buffer;
     };
 };
 
@@ -119,6 +130,24 @@ struct qemu_plugin_scoreboard {
     QLIST_ENTRY(qemu_plugin_scoreboard) entry;
 };
 
+/* A memory access buffer is a scoreboard of qemu_plugin_mem_buffer_vcpu */
+struct qemu_plugin_mem_buffer {
+    struct qemu_plugin_scoreboard *score;
+    size_t n_records;
+    qemu_plugin_vcpu_mem_buffer_cb_t cb;
+    void *userdata;
+    QLIST_ENTRY(qemu_plugin_mem_buffer) entry;
+};
+
+/*
+ * @used is kept in bytes, so that generated code can append a record
+ * without having to scale the index.
+ */
+struct qemu_plugin_mem_buffer_vcpu {
+    uintptr_t used;
+    struct qemu_plugin_mem_record records[];
+};
+
 /*
  * qemu_plugin_insn allocate and cleanup functions. We don't expect to
  * cleanup many of these structures. They are reused for each fresh
@@ -220,8 +249,19 @@ void qemu_plugin_vcpu_syscall_ret(CPUState *cpu, int64_t num, int64_t ret);
 void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
                              MemOpIdx oi, enum qemu_plugin_mem_rw rw);
 
+void qemu_plugin_mem_buffer_flush_vcpu(struct qemu_plugin_mem_buffer *buf,
+                                       unsigned int cpu_index);
+
 void qemu_plugin_flush_cb(void);
 
+/**
+ * qemu_plugin_loaded() - check whether any plugin is installed
+ *
+ * Translated code may then reference plugin data that is only released
+ * by a full tb_flush().
+ */
+bool qemu_plugin_loaded(void);
+
 void qemu_plugin_atexit_cb(void);
 
 void qemu_plugin_add_dyn_cb_arr(GArray *arr);
@@ -309,6 +349,11 @@ static inline void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
 static inline void qemu_plugin_flush_cb(void)
 { }
 
+static inline bool qemu_plugin_loaded(void)
+{
+    return false;
+}
+
 static inline void qemu_plugin_atexit_cb(void)
 { }
 
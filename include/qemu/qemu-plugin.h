@@ -329,6 +329,61 @@ void qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
     qemu_plugin_u64 entry,
     uint64_t imm);
 
+/**
+ * enum qemu_plugin_cond - condition to enable callback
+ *
+ * @QEMU_PLUGIN_COND_NEVER: false
+ * @QEMU_PLUGIN_COND_ALWAYS: true
+ * @QEMU_PLUGIN_COND_EQ: is equal?
+ * @QEMU_PLUGIN_COND_NE: is not equal?
+ * @QEMU_PLUGIN_COND_LT: is less than?
+ * @QEMU_PLUGIN_COND_LE: is less than or equal?
+ * @QEMU_PLUGIN_COND_GT: is greater than?
+ * @QEMU_PLUGIN_COND_GE: is greater than or equal?
+ *
+ * Comparisons are unsigned.
+ */
+enum qemu_plugin_cond {
+    QEMU_PLUGIN_COND_NEVER,
+    QEMU_PLUGIN_COND_ALWAYS,
+    QEMU_PLUGIN_COND_EQ,
+    QEMU_PLUGIN_COND_NE,
+    QEMU_PLUGIN_COND_LT,
+    QEMU_PLUGIN_COND_LE,
+    QEMU_PLUGIN_COND_GT,
+    QEMU_PLUGIN_COND_GE,
+};
+
+/**
+ * qemu_plugin_register_vcpu_tb_exec_cond_cb() - register conditional callback
+ * @tb: the opaque qemu_plugin_tb handle for the translation
+ * @cb: callback function
+ * @flags: does the plugin read or write the CPU's registers?
+ * @cond: condition to enable callback
+ * @entry: first operand for condition
+ * @imm: second operand for condition
+ * @userdata: any plugin data to pass to the @cb?
+ *
+ * The @cb function is called when a translated unit executes if
+ * entry @cond imm is true. The comparison is generated inline, so a
+ * callback that rarely fires costs little more than an inline op.
+ * It is evaluated after the inline ops registered on the same @tb,
+ * which makes it possible to increment a counter and call @cb once
+ * it reaches a threshold.
+ * If condition is QEMU_PLUGIN_COND_ALWAYS, condition is never interpreted and
+ * this function is equivalent to qemu_plugin_register_vcpu_tb_exec_cb.
+ * If condition QEMU_PLUGIN_COND_NEVER, condition is never interpreted and
+ * callback is never installed.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_tb_exec_cond_cb(struct qemu_plugin_tb *tb,
+                                               qemu_plugin_vcpu_udata_cb_t cb,
+                                               enum qemu_plugin_cb_flags flags,
+                                               enum qemu_plugin_cond cond,
+                                               qemu_plugin_u64 entry,
+                                               uint64_t imm,
+                                               void *userdata);
+
 /**
  * qemu_plugin_register_vcpu_insn_exec_cb() - register insn execution cb
  * @insn: the opaque qemu_plugin_insn handle for an instruction
@@ -344,6 +399,30 @@ void qemu_plugin_register_vcpu_insn_exec_cb(struct qemu_plugin_insn *insn,
                                             enum qemu_plugin_cb_flags flags,
                                             void *userdata);
 
+/**
+ * qemu_plugin_register_vcpu_insn_exec_cond_cb() - conditional insn execution cb
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @cb: callback function
+ * @flags: does the plugin read or write the CPU's registers?
+ * @cond: condition to enable callback
+ * @entry: first operand for condition
+ * @imm: second operand for condition
+ * @userdata: any plugin data to pass to the @cb?
+ *
+ * The @cb function is called when an instruction executes if
+ * entry @cond imm is true. See qemu_plugin_register_vcpu_tb_exec_cond_cb
+ * for details.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_insn_exec_cond_cb(
+    struct qemu_plugin_insn *insn,
+    qemu_plugin_vcpu_udata_cb_t cb,
+    enum qemu_plugin_cb_flags flags,
+    enum qemu_plugin_cond cond,
+    qemu_plugin_u64 entry,
+    uint64_t imm,
+    void *userdata);
+
 /**
  * qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu() - insn exec inline op
  * @insn: the opaque qemu_plugin_insn handle for an instruction
@@ -586,6 +665,106 @@ void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
     qemu_plugin_u64 entry,
     uint64_t imm);
 
+/**
+ * struct qemu_plugin_mem_record - a buffered memory access
+ * @vaddr: virtual address of the access
+ * @pc: virtual address of the instruction making the access
+ * @info: opaque memory transaction handle, see qemu_plugin_mem_*()
+ * @reserved: padding, always zero
+ */
+struct qemu_plugin_mem_record {
+    uint64_t vaddr;
+    uint64_t pc;
+    qemu_plugin_meminfo_t info;
+    uint32_t reserved;
+};
+
+/** struct qemu_plugin_mem_buffer - opaque per-vcpu memory access buffer */
+struct qemu_plugin_mem_buffer;
+
+/**
+ * typedef qemu_plugin_vcpu_mem_buffer_cb_t - memory buffer flush callback
+ * @vcpu_index: the vCPU whose accesses are reported
+ * @records: the accesses, in execution order
+ * @n: number of entries in @records
+ * @userdata: any user data provided at buffer creation
+ *
+ * @records is only valid for the duration of the callback.
+ */
+typedef void (*qemu_plugin_vcpu_mem_buffer_cb_t)(
+    unsigned int vcpu_index, const struct qemu_plugin_mem_record *records,
+    size_t n, void *userdata);
+
+/* smallest number of records accepted by qemu_plugin_mem_buffer_new() */
+#define QEMU_PLUGIN_MEM_BUFFER_MIN_RECORDS 1024
+
+/**
+ * qemu_plugin_mem_buffer_new() - alloc a new memory access buffer
+ * @n_records: capacity of the buffer of each vCPU, in records
+ * @cb: callback invoked when a vCPU's buffer is flushed
+ * @userdata: any plugin data to pass to @cb
+ *
+ * Each vCPU gets its own buffer of @n_records entries, which is rounded
+ * up to QEMU_PLUGIN_MEM_BUFFER_MIN_RECORDS. @cb is called on the vCPU
+ * thread whenever the buffer of that vCPU is about to overflow, when the
+ * vCPU goes idle (system emulation only) or exits, or when
+ * qemu_plugin_mem_buffer_flush() is called.
+ *
+ * The buffer is deliberately not flushed when a translation block exits,
+ * as that would call @cb for every few accesses. Records can therefore
+ * be reported well after the instruction that made them, and callbacks
+ * of other kinds (e.g. TB or syscall callbacks) must not assume that
+ * all earlier accesses of the vCPU have been seen.
+ *
+ * Returns a pointer to a new buffer. It must be freed using
+ * qemu_plugin_mem_buffer_free.
+ */
+QEMU_PLUGIN_API
+struct qemu_plugin_mem_buffer *
+qemu_plugin_mem_buffer_new(size_t n_records,
+                           qemu_plugin_vcpu_mem_buffer_cb_t cb,
+                           void *userdata);
+
+/**
+ * qemu_plugin_mem_buffer_free() - free a memory access buffer
+ * @buf: buffer to free
+ *
+ * Pending records are discarded. No instrumentation using @buf must
+ * remain in the translation cache, see qemu_plugin_reset().
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_mem_buffer_free(struct qemu_plugin_mem_buffer *buf);
+
+/**
+ * qemu_plugin_mem_buffer_flush() - report pending records of all vCPUs
+ * @buf: buffer to flush
+ *
+ * This must only be called when no vCPU can append to @buf, for instance
+ * from an atexit callback.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_mem_buffer_flush(struct qemu_plugin_mem_buffer *buf);
+
+/**
+ * qemu_plugin_register_vcpu_mem_buffer() - record memory accesses in a buffer
+ * @insn: handle for instruction to instrument
+ * @rw: record reads, writes or both
+ * @buf: buffer to append to
+ *
+ * This is a cheaper alternative to qemu_plugin_register_vcpu_mem_cb().
+ * Every memory access generated by the instruction is appended to the
+ * current vCPU's buffer by inline code, and the callback of @buf is
+ * only called with the whole batch, see qemu_plugin_mem_buffer_new()
+ * for when that happens.
+ *
+ * Accesses made from helpers are appended as well, but cause more
+ * frequent flushes.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_mem_buffer(struct qemu_plugin_insn *insn,
+                                          enum qemu_plugin_mem_rw rw,
+                                          struct qemu_plugin_mem_buffer *buf);
+
 typedef void
 (*qemu_plugin_vcpu_syscall_cb_t)(qemu_plugin_id_t id, unsigned int vcpu_index,
                                  int64_t num, uint64_t a1, uint64_t a2,
@@ -25,16 +25,25 @@
 #ifndef TCG_STARTUP_H
 #define TCG_STARTUP_H
 
+/* Flags for tcg_init() */
+/* Retire the oldest code regions instead of flushing everything */
+#define TCG_INIT_EVICT          (1u << 0)
+/* Prefer host memory from the NUMA node of the thread using a region */
+#define TCG_INIT_NUMA           (1u << 1)
+/* Align the code regions to huge pages, without guard pages */
+#define TCG_INIT_HUGEPAGES      (1u << 2)
+
 /**
  * tcg_init: Initialize the TCG runtime
  * @tb_size: translation buffer size
  * @splitwx: use separate rw and rx mappings
  * @max_cpus: number of vcpus in system mode
+ * @flags: TCG_INIT_* flags
  *
  * Allocate and initialize TCG resources, especially the JIT buffer.
  * In user-only mode, @max_cpus is unused.
  */
-void tcg_init(size_t tb_size, int splitwx, unsigned max_cpus);
+void tcg_init(size_t tb_size, int splitwx, unsigned max_cpus, unsigned flags);
 
 /**
  * tcg_register_thread: Register this thread with the TCG runtime
@@ -476,6 +476,10 @@ static inline TCGRegSet output_pref(const TCGOp *op, unsigned i)
     return i < ARRAY_SIZE(op->output_pref) ? op->output_pref[i] : 0;
 }
 
+/* Optional passes of tcg_optimize(), see TCGContext.opt_flags.  */
+#define TCG_OPT_CSE     (1u << 0)   /* common subexpression elimination */
+#define TCG_OPT_CSE_LD  (1u << 1)   /* redundant guest load elimination */
+
 struct TCGContext {
     uint8_t *pool_cur, *pool_end;
     TCGPool *pool_first, *pool_current, *pool_first_large;
@@ -492,6 +496,11 @@ struct TCGContext {
     uint8_t insn_start_words;
     TCGBar guest_mo;
 
+    /* Optional optimizer passes and the number of ops they removed.  */
+    unsigned opt_flags;
+    size_t opt_cse_count;
+    size_t opt_ld_count;
+
     TCGRegSet reserved_regs;
     intptr_t current_frame_offset;
     intptr_t frame_start;
@@ -519,6 +528,9 @@ struct TCGContext {
     /* Threshold to flush the translated code buffer.  */
     void *code_gen_highwater;
 
+    /* Host NUMA node preferred for code_gen_buffer, or -1.  */
+    int code_gen_node;
+
     /* Track which vCPU triggers events */
     CPUState *cpu;                      /* *_trans */
 
@@ -755,9 +767,15 @@ void tcg_pool_reset(TCGContext *s);
 TranslationBlock *tcg_tb_alloc(TCGContext *s);
 
 void tcg_region_reset_all(void);
+bool tcg_region_evict_enabled(void);
+size_t tcg_region_evict_prepare(void);
+bool tcg_region_evicting(const void *p);
+void tcg_region_evict_foreach(GTraverseFunc func, gpointer user_data);
+void tcg_region_evict_commit(void);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
+void tcg_optimize_counts(size_t *cse, size_t *ld);
 
 void tcg_tb_insert(TranslationBlock *tb);
 void tcg_tb_remove(TranslationBlock *tb);
@@ -304,9 +304,8 @@ enum {
     QEMU__IFLA_VF_MAX,
 };
 
-TargetFdTrans **target_fd_trans;
+TargetFdTransTable *target_fd_trans;
 QemuMutex target_fd_trans_lock;
-unsigned int target_fd_max;
 
 static void tswap_nlmsghdr(struct nlmsghdr *nlh)
 {
@@ -17,6 +17,7 @@
 #define FD_TRANS_H
 
 #include "qemu/lockable.h"
+#include "qemu/rcu.h"
 
 typedef abi_long (*TargetFdDataFunc)(void *, size_t);
 typedef abi_long (*TargetFdAddrFunc)(void *, abi_ulong, socklen_t);
@@ -26,69 +27,95 @@ typedef struct TargetFdTrans {
     TargetFdAddrFunc target_to_host_addr;
 } TargetFdTrans;
 
-extern TargetFdTrans **target_fd_trans;
-extern QemuMutex target_fd_trans_lock;
+/*
+ * Most file descriptors have no translator, and read(), write() and
+ * friends look them up on every call.  Readers therefore only take
+ * the RCU read lock; target_fd_trans_lock serializes the updates, and
+ * the table is replaced when it grows.
+ */
+typedef struct TargetFdTransTable {
+    struct rcu_head rcu;
+    unsigned int max;
+    TargetFdTrans *trans[];
+} TargetFdTransTable;
 
-extern unsigned int target_fd_max;
+extern TargetFdTransTable *target_fd_trans;
+extern QemuMutex target_fd_trans_lock;
 
 static inline void fd_trans_init(void)
 {
     qemu_mutex_init(&target_fd_trans_lock);
 }
 
-static inline TargetFdDataFunc fd_trans_target_to_host_data(int fd)
+static inline TargetFdTrans *fd_trans_lookup(int fd)
 {
+    TargetFdTransTable *table;
+
     if (fd < 0) {
         return NULL;
     }
 
-    QEMU_LOCK_GUARD(&target_fd_trans_lock);
-    if (fd < target_fd_max && target_fd_trans[fd]) {
-        return target_fd_trans[fd]->target_to_host_data;
+    RCU_READ_LOCK_GUARD();
+    table = qatomic_rcu_read(&target_fd_trans);
+    if (table && fd < table->max) {
+        return qatomic_read(&table->trans[fd]);
     }
     return NULL;
 }
 
+/* Upper bound of the file descriptors that may have a translator */
+static inline unsigned int fd_trans_max(void)
+{
+    TargetFdTransTable *table;
+
+    RCU_READ_LOCK_GUARD();
+    table = qatomic_rcu_read(&target_fd_trans);
+    return table ? table->max : 0;
+}
+
+static inline TargetFdDataFunc fd_trans_target_to_host_data(int fd)
+{
+    TargetFdTrans *trans = fd_trans_lookup(fd);
+
+    return trans ? trans->target_to_host_data : NULL;
+}
+
 static inline TargetFdDataFunc fd_trans_host_to_target_data(int fd)
 {
-    if (fd < 0) {
-        return NULL;
-    }
+    TargetFdTrans *trans = fd_trans_lookup(fd);
 
-    QEMU_LOCK_GUARD(&target_fd_trans_lock);
-    if (fd < target_fd_max && target_fd_trans[fd]) {
-        return target_fd_trans[fd]->host_to_target_data;
-    }
-    return NULL;
+    return trans ? trans->host_to_target_data : NULL;
 }
 
 static inline TargetFdAddrFunc fd_trans_target_to_host_addr(int fd)
 {
-    if (fd < 0) {
-        return NULL;
-    }
+    TargetFdTrans *trans = fd_trans_lookup(fd);
 
-    QEMU_LOCK_GUARD(&target_fd_trans_lock);
-    if (fd < target_fd_max && target_fd_trans[fd]) {
-        return target_fd_trans[fd]->target_to_host_addr;
-    }
-    return NULL;
+    return trans ? trans->target_to_host_addr : NULL;
 }
 
 static inline void internal_fd_trans_register_unsafe(int fd,
                                                      TargetFdTrans *trans)
 {
-    unsigned int oldmax;
-
-    if (fd >= target_fd_max) {
-        oldmax = target_fd_max;
-        target_fd_max = ((fd >> 6) + 1) << 6; /* by slice of 64 entries */
-        target_fd_trans = g_renew(TargetFdTrans *,
-                                  target_fd_trans, target_fd_max);
-        memset((void *)(target_fd_trans + oldmax), 0,
-               (target_fd_max - oldmax) * sizeof(TargetFdTrans *));
+    TargetFdTransTable *old = target_fd_trans;
+    unsigned int oldmax = old ? old->max : 0;
+
+    if (fd >= oldmax) {
+        unsigned int max = ((fd >> 6) + 1) << 6; /* by slice of 64 entries */
+        TargetFdTransTable *table;
+
+        table = g_malloc0(sizeof(*table) + max * sizeof(TargetFdTrans *));
+        table->max = max;
+        if (old) {
+            memcpy(table->trans, old->trans,
+                   oldmax * sizeof(TargetFdTrans *));
+        }
+        qatomic_rcu_set(&target_fd_trans, table);
+        if (old) {
+            g_free_rcu(old, rcu);
+        }
     }
-    target_fd_trans[fd] = trans;
+    qatomic_set(&target_fd_trans->trans[fd], trans);
 }
 
 static inline void fd_trans_register(int fd, TargetFdTrans *trans)
@@ -99,14 +126,20 @@ static inline void fd_trans_register(int fd, TargetFdTrans *trans)
 
 static inline void internal_fd_trans_unregister_unsafe(int fd)
 {
-    if (fd >= 0 && fd < target_fd_max) {
-        target_fd_trans[fd] = NULL;
+    if (fd >= 0 && target_fd_trans && fd < target_fd_trans->max) {
+        qatomic_set(&target_fd_trans->trans[fd], NULL);
     }
 }
 
 static inline void fd_trans_unregister(int fd)
 {
-    if (fd < 0) {
+    /*
+     * Skip the lock for the common case.  A translator for @fd can only
+     * be registered concurrently if the guest races close() with the
+     * creation of a new file descriptor, in which case either order is
+     * valid.
+     */
+    if (fd_trans_lookup(fd) == NULL) {
         return;
     }
 
@@ -116,10 +149,13 @@ static inline void fd_trans_unregister(int fd)
 
 static inline void fd_trans_dup(int oldfd, int newfd)
 {
+    TargetFdTrans *trans;
+
     QEMU_LOCK_GUARD(&target_fd_trans_lock);
     internal_fd_trans_unregister_unsafe(newfd);
-    if (oldfd < target_fd_max && target_fd_trans[oldfd]) {
-        internal_fd_trans_register_unsafe(newfd, target_fd_trans[oldfd]);
+    trans = fd_trans_lookup(oldfd);
+    if (trans) {
+        internal_fd_trans_register_unsafe(newfd, trans);
     }
 }
 
@@ -9232,7 +9232,7 @@ static abi_long do_syscall1(CPUArchState *cpu_env, int num, abi_long arg1,
         ret = get_errno(sys_close_range(arg1, arg2, arg3));
         if (ret == 0 && !(arg3 & CLOSE_RANGE_CLOEXEC)) {
             abi_long fd, maxfd;
-            maxfd = MIN(arg2, target_fd_max);
+            maxfd = MIN(arg2, fd_trans_max());
             for (fd = arg1; fd < maxfd; fd++) {
                 fd_trans_unregister(fd);
             }
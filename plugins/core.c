@@ -261,10 +261,30 @@ void qemu_plugin_vcpu_init_hook(CPUState *cpu)
     plugin_vcpu_cb__simple(cpu, QEMU_PLUGIN_EV_VCPU_INIT);
 }
 
+/*
+ * Report the pending memory accesses of @cpu.  Buffers are not flushed
+ * at every TB exit, which would call back once per TB and lose most of
+ * the batching; instead this runs whenever the vCPU stops executing for
+ * a while, so records never sit in a buffer indefinitely.
+ */
+static void plugin_mem_buffers_flush(CPUState *cpu)
+{
+    struct qemu_plugin_mem_buffer *buf;
+
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_FOREACH(buf, &plugin.mem_buffers, entry) {
+        qemu_plugin_mem_buffer_flush_vcpu(buf, cpu->cpu_index);
+    }
+    qemu_rec_mutex_unlock(&plugin.lock);
+}
+
 void qemu_plugin_vcpu_exit_hook(CPUState *cpu)
 {
     bool success;
 
+    /* report the accesses of this vCPU before it goes away */
+    plugin_mem_buffers_flush(cpu);
+
     plugin_vcpu_cb__simple(cpu, QEMU_PLUGIN_EV_VCPU_EXIT);
 
     qemu_rec_mutex_lock(&plugin.lock);
@@ -346,6 +366,25 @@ void plugin_register_dyn_cb__udata(GArray **arr,
     dyn_cb->type = PLUGIN_CB_REGULAR;
 }
 
+void plugin_register_dyn_cond_cb__udata(GArray **arr,
+                                        qemu_plugin_vcpu_udata_cb_t cb,
+                                        enum qemu_plugin_cb_flags flags,
+                                        enum qemu_plugin_cond cond,
+                                        qemu_plugin_u64 entry,
+                                        uint64_t imm,
+                                        void *udata)
+{
+    struct qemu_plugin_dyn_cb *dyn_cb = plugin_get_dyn_cb(arr);
+
+    dyn_cb->userp = udata;
+    /* Note flags are discarded as unused. */
+    dyn_cb->f.vcpu_udata = cb;
+    dyn_cb->type = PLUGIN_CB_COND;
+    dyn_cb->cond.cond = cond;
+    dyn_cb->cond.entry = entry;
+    dyn_cb->cond.imm = imm;
+}
+
 void plugin_register_vcpu_mem_cb(GArray **arr,
                                  void *cb,
                                  enum qemu_plugin_cb_flags flags,
@@ -362,6 +401,21 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
     dyn_cb->f.generic = cb;
 }
 
+void plugin_register_vcpu_mem_buffer(GArray **arr,
+                                     enum qemu_plugin_mem_rw rw,
+                                     struct qemu_plugin_mem_buffer *buf,
+                                     uint64_t pc)
+{
+    struct qemu_plugin_dyn_cb *dyn_cb;
+
+    dyn_cb = plugin_get_dyn_cb(arr);
+    dyn_cb->userp = NULL;
+    dyn_cb->type = PLUGIN_CB_MEM_BUFFER;
+    dyn_cb->rw = rw;
+    dyn_cb->mem_buffer.buf = buf;
+    dyn_cb->mem_buffer.pc = pc;
+}
+
 /*
  * Disable CFI checks.
  * The callback function has been loaded from an external library so we do not
@@ -433,6 +487,7 @@ void qemu_plugin_vcpu_idle_cb(CPUState *cpu)
 {
     /* idle and resume cb may be called before init, ignore in this case */
     if (cpu->cpu_index < plugin.num_vcpus) {
+        plugin_mem_buffers_flush(cpu);
         plugin_vcpu_cb__simple(cpu, QEMU_PLUGIN_EV_VCPU_IDLE);
     }
 }
@@ -476,6 +531,11 @@ void qemu_plugin_flush_cb(void)
     plugin_cb__simple(QEMU_PLUGIN_EV_FLUSH);
 }
 
+bool qemu_plugin_loaded(void)
+{
+    return !QTAILQ_EMPTY(&plugin.ctxs);
+}
+
 void exec_inline_op(struct qemu_plugin_dyn_cb *cb, int cpu_index)
 {
     char *ptr = cb->inline_insn.entry.score->data->data;
@@ -493,6 +553,57 @@ void exec_inline_op(struct qemu_plugin_dyn_cb *cb, int cpu_index)
     }
 }
 
+/*
+ * Disable CFI checks.
+ * The callback function has been loaded from an external library so we do not
+ * have type information
+ */
+QEMU_DISABLE_CFI
+void qemu_plugin_mem_buffer_flush_vcpu(struct qemu_plugin_mem_buffer *buf,
+                                       unsigned int cpu_index)
+{
+    struct qemu_plugin_mem_buffer_vcpu *vbuf =
+        (void *)(buf->score->data->data +
+                 cpu_index * g_array_get_element_size(buf->score->data));
+    size_t n = vbuf->used / sizeof(struct qemu_plugin_mem_record);
+
+    if (n) {
+        buf->cb(cpu_index, vbuf->records, n, buf->userdata);
+        vbuf->used = 0;
+    }
+}
+
+/*
+ * Accesses from helpers are appended like the inline ones. Generated code
+ * only checks for space at the start of an instruction, so keep at least
+ * half of the buffer free for the inline accesses that may follow.
+ */
+static void exec_mem_buffer(struct qemu_plugin_dyn_cb *cb, int cpu_index,
+                            uint64_t vaddr, qemu_plugin_meminfo_t info)
+{
+    struct qemu_plugin_mem_buffer *buf = cb->mem_buffer.buf;
+    struct qemu_plugin_mem_buffer_vcpu *vbuf =
+        (void *)(buf->score->data->data +
+                 cpu_index * g_array_get_element_size(buf->score->data));
+    struct qemu_plugin_mem_record *rec;
+    size_t n = vbuf->used / sizeof(*rec);
+
+    if (n == buf->n_records) {
+        qemu_plugin_mem_buffer_flush_vcpu(buf, cpu_index);
+        n = 0;
+    }
+    rec = &vbuf->records[n];
+    rec->vaddr = vaddr;
+    rec->pc = cb->mem_buffer.pc;
+    rec->info = info;
+    rec->reserved = 0;
+    vbuf->used += sizeof(*rec);
+
+    if (n + 1 > buf->n_records / 2) {
+        qemu_plugin_mem_buffer_flush_vcpu(buf, cpu_index);
+    }
+}
+
 void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
                              MemOpIdx oi, enum qemu_plugin_mem_rw rw)
 {
@@ -507,7 +618,7 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
             &g_array_index(arr, struct qemu_plugin_dyn_cb, i);
 
         if (!(rw & cb->rw)) {
-                break;
+            continue;
         }
         switch (cb->type) {
         case PLUGIN_CB_REGULAR:
@@ -517,6 +628,10 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
         case PLUGIN_CB_INLINE:
             exec_inline_op(cb, cpu->cpu_index);
             break;
+        case PLUGIN_CB_MEM_BUFFER:
+            exec_mem_buffer(cb, cpu->cpu_index, vaddr,
+                            make_plugin_meminfo(oi, rw));
+            break;
         default:
             g_assert_not_reached();
         }
@@ -617,6 +732,7 @@ static void __attribute__((__constructor__)) plugin_init(void)
     plugin.cpu_ht = g_hash_table_new(g_int_hash, g_int_equal);
     QLIST_INIT(&plugin.scoreboards);
     plugin.scoreboard_alloc_size = 16; /* avoid frequent reallocation */
+    QLIST_INIT(&plugin.mem_buffers);
     QTAILQ_INIT(&plugin.ctxs);
     qht_init(&plugin.dyn_cb_arr_ht, plugin_dyn_cb_arr_cmp, 16,
              QHT_MODE_AUTO_RESIZE);
@@ -651,3 +767,34 @@ void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
     g_array_free(score->data, TRUE);
     g_free(score);
 }
+
+struct qemu_plugin_mem_buffer *
+plugin_mem_buffer_new(size_t n_records, qemu_plugin_vcpu_mem_buffer_cb_t cb,
+                      void *userdata)
+{
+    struct qemu_plugin_mem_buffer *buf;
+
+    buf = g_new0(struct qemu_plugin_mem_buffer, 1);
+    buf->n_records = MAX(n_records, QEMU_PLUGIN_MEM_BUFFER_MIN_RECORDS);
+    buf->cb = cb;
+    buf->userdata = userdata;
+    buf->score = plugin_scoreboard_new(
+        sizeof(struct qemu_plugin_mem_buffer_vcpu) +
+        buf->n_records * sizeof(struct qemu_plugin_mem_record));
+
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_INSERT_HEAD(&plugin.mem_buffers, buf, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    return buf;
+}
+
+void plugin_mem_buffer_free(struct qemu_plugin_mem_buffer *buf)
+{
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_REMOVE(buf, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    plugin_scoreboard_free(buf->score);
+    g_free(buf);
+}
@@ -187,6 +187,16 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                one-insn-per-tb=on|off (one guest instruction per TCG translation block)\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                tb-evict=on|off (retire the oldest TCG code regions instead of flushing, default off)\n"
+    "                tb-numa=on|off (place TCG code regions on the NUMA node of their vCPU, default off)\n"
+    "                tb-hugepages=on|off (align TCG code regions to huge pages, default off)\n"
+    "                jmp-cache-bits=n (TCG jump cache size, log2 of entries, default 12)\n"
+    "                jmp-cache-adaptive=on|off (resize the TCG jump cache on demand)\n"
+    "                jmp-cache-stats=on|off (count TCG jump cache hits and misses, default off)\n"
+    "                jmp-cache-l2-bits=n,jmp-cache-l2-ways=n (TCG second level jump cache geometry)\n"
+    "                victim-tlb-size=n,victim-tlb-ways=n (TCG victim TLB geometry, default 8 fully associative)\n"
+    "                cse=on|off,cse-loads=on|off (TCG common subexpression and redundant load elimination)\n"
+    "                profile-period=n (TCG sampling profiler period in microseconds, default 0, disabled)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                eager-split-size=n (KVM Eager Page Split chunk size, default 0, disabled. ARM only)\n"
     "                notify-vmexit=run|internal-error|disable,notify-window=n (enable notify VM exit and set notify window, x86 only)\n"
@@ -230,6 +240,84 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``tb-evict=on|off``
+        When the TCG translation block cache is full, retires the oldest
+        quarter of its regions and keeps the translations held by the
+        others, instead of flushing every translation at once. QEMU
+        falls back to a full flush when the cache has a single region or
+        when TCG plugins are loaded. The default is off. Flush and
+        eviction counts and pause times are reported by ``info jit``.
+
+    ``tb-numa=on|off``
+        Binds each region of the TCG translation block cache to the host
+        NUMA node that the vCPU thread using it ran on when it started,
+        so that hot translated code is fetched from local memory.  This
+        is most useful when vCPU threads are pinned to host nodes.  It
+        is only available on Linux hosts. The default is off.
+
+    ``tb-hugepages=on|off``
+        Aligns the TCG translation block cache and its regions to huge
+        pages, and drops the guard pages between regions, so that the
+        whole cache can be backed by transparent huge pages and needs
+        fewer host iTLB entries.  With ``split-wx=on`` the cache is a
+        shared memory object, which only gets huge pages if the host
+        enables them for shared memory (``shmem_enabled`` on Linux).
+        The default is off.
+
+    ``jmp-cache-bits=n``
+        Sets the number of entries of the per-vCPU TB jump cache to 2^n,
+        between 2^6 and 2^18. The default is 2^12. Guests with a large
+        code footprint benefit from a bigger cache, while a smaller one
+        saves memory for guests with many small vCPUs.
+
+    ``jmp-cache-adaptive=on|off``
+        Lets each vCPU grow or shrink its TB jump cache, starting from
+        ``jmp-cache-bits``, depending on the miss rate it observes.
+        The default is off.
+
+    ``jmp-cache-stats=on|off``
+        Counts the TB jump cache lookups and the misses of each level,
+        and reports them in ``info jit`` and ``query-stats``. Counting
+        costs a little on every TB lookup, so the default is off; the
+        counters are also kept with ``jmp-cache-adaptive=on``, which
+        depends on them.
+
+    ``jmp-cache-l2-bits=n,jmp-cache-l2-ways=n``
+        Enables a second level, set associative TB jump cache per vCPU
+        with 2^n sets of the given number of ways (default 4), which is
+        searched before the global TB hash table. This reduces contention
+        on the hash table with many vCPUs. The default is 0, disabled.
+        Hit rates are reported by ``info jit`` with ``jmp-cache-stats=on``.
+
+    ``victim-tlb-size=n,victim-tlb-ways=n``
+        Sets the number of entries of the victim TLB, which holds
+        translations recently evicted from the softmmu TLB of each MMU
+        mode, and its associativity. Both must be powers of 2, no larger
+        than 1024. The default is 8 entries, fully associative; guests
+        with scattered working sets may benefit from e.g. 256 entries
+        with 4 ways. Hits and misses per MMU mode are reported by
+        ``info jit``.
+
+    ``cse=on|off,cse-loads=on|off``
+        Makes the TCG optimizer reuse the result of an identical earlier
+        operation within an extended basic block instead of computing
+        it again. ``cse-loads`` does the same for guest memory loads from
+        the same address, as long as no store, barrier or helper call
+        with side effects comes in between; since this also merges
+        repeated reads of the same device register, it is only safe for
+        guests that do not poll MMIO within a translation block. Both
+        default to off. The number of eliminated operations is reported
+        by ``info opcount``.
+
+    ``profile-period=n``
+        Samples the host PC of each vCPU thread every n microseconds of
+        CPU time spent by that thread, between 100 and 1000000, and
+        attributes the samples to the guest PC of the translation block
+        being executed. Samples taken outside translated code, e.g. in
+        helpers, are reported by host address. The results are shown by
+        ``info tcg-profile``. The default is 0, disabled. Only available
+        for system emulation on Linux hosts.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefore taking advantage of
@@ -5644,6 +5644,87 @@ void sve_cont_ldst_mte_check(SVEContLdSt *info, CPUARMState *env,
     }
 }
 
+/*
+ * Expand the predicate bits governing one 64-bit unit of the vector
+ * into a mask of the active elements within that unit.
+ */
+static inline uint64_t sve_pred_unit_mask(uint8_t pg, int esz)
+{
+    switch (esz) {
+    case MO_8:
+        return expand_pred_b(pg);
+    case MO_16:
+        return expand_pred_h(pg);
+    case MO_32:
+        return expand_pred_s(pg);
+    default:
+        return -(uint64_t)(pg & 1);
+    }
+}
+
+/*
+ * Return true if a contiguous access of a single register may be
+ * performed with whole 64-bit host accesses: the elements are not
+ * extended or truncated, memory is little-endian, so that the memory
+ * image matches the layout of ZReg.d[], and the whole vector is on
+ * the one page, so that the bytes of inactive elements are addressable.
+ */
+static inline bool sve_cont_ldst_bulk_ok(target_ulong addr, intptr_t reg_max,
+                                         int esz, int msz, int N, bool le)
+{
+    return N == 1 && esz == msz && (le || esz == MO_8) &&
+           ((addr ^ (addr + reg_max - 1)) & TARGET_PAGE_MASK) == 0;
+}
+
+/*
+ * Load all active elements of @vd from RAM at @host, zeroing the
+ * inactive elements.  Reading the bytes of the inactive elements
+ * has no side effects, as the page is RAM.
+ */
+static inline QEMU_ALWAYS_INLINE
+void sve_ld1_bulk(void *vd, uint64_t *vg, void *host,
+                  intptr_t reg_max, int esz)
+{
+    uint64_t *d = vd;
+    uint8_t *pg = (uint8_t *)vg;
+    intptr_t i;
+
+    for (i = 0; i < reg_max / 8; i++) {
+        uint64_t mask = sve_pred_unit_mask(pg[H1(i)], esz);
+
+        d[i] = mask ? ldq_le_p(host + i * 8) & mask : 0;
+    }
+}
+
+/*
+ * Store all active elements of @vd to RAM at @host.  The inactive
+ * elements must not be written, even with their current contents,
+ * as another cpu may be concurrently writing to them: use the per
+ * element @host_fn for any partially active unit.
+ */
+static inline QEMU_ALWAYS_INLINE
+void sve_st1_bulk(void *vd, uint64_t *vg, void *host, intptr_t reg_max,
+                  int esz, sve_ldst1_host_fn *host_fn)
+{
+    uint64_t *d = vd;
+    uint8_t *pg = (uint8_t *)vg;
+    intptr_t i, reg_off;
+
+    for (i = 0; i < reg_max / 8; i++) {
+        uint64_t mask = sve_pred_unit_mask(pg[H1(i)], esz);
+
+        if (mask == -1) {
+            stq_le_p(host + i * 8, d[i]);
+        } else if (mask) {
+            for (reg_off = i * 8; reg_off < i * 8 + 8; reg_off += 1 << esz) {
+                if ((vg[reg_off >> 6] >> (reg_off & 63)) & 1) {
+                    host_fn(vd, reg_off, host + reg_off);
+                }
+            }
+        }
+    }
+}
+
 /*
  * Common helper for all contiguous 1,2,3,4-register predicated stores.
  */
@@ -5651,7 +5732,7 @@ static inline QEMU_ALWAYS_INLINE
 void sve_ldN_r(CPUARMState *env, uint64_t *vg, const target_ulong addr,
                uint32_t desc, const uintptr_t retaddr,
                const int esz, const int msz, const int N, uint32_t mtedesc,
-               sve_ldst1_host_fn *host_fn,
+               const bool le, sve_ldst1_host_fn *host_fn,
                sve_ldst1_tlb_fn *tlb_fn)
 {
     const unsigned rd = simd_data(desc);
@@ -5728,6 +5809,12 @@ void sve_ldN_r(CPUARMState *env, uint64_t *vg, const target_ulong addr,
 
     /* The entire operation is in RAM, on valid pages. */
 
+    if (sve_cont_ldst_bulk_ok(addr, reg_max, esz, msz, N, le)) {
+        sve_ld1_bulk(&env->vfp.zregs[rd], vg, info.page[0].host,
+                     reg_max, esz);
+        return;
+    }
+
     for (i = 0; i < N; ++i) {
         memset(&env->vfp.zregs[(rd + i) & 31], 0, reg_max);
     }
@@ -5789,7 +5876,7 @@ void sve_ldN_r(CPUARMState *env, uint64_t *vg, const target_ulong addr,
 static inline QEMU_ALWAYS_INLINE
 void sve_ldN_r_mte(CPUARMState *env, uint64_t *vg, target_ulong addr,
                    uint32_t desc, const uintptr_t ra,
-                   const int esz, const int msz, const int N,
+                   const int esz, const int msz, const int N, const bool le,
                    sve_ldst1_host_fn *host_fn,
                    sve_ldst1_tlb_fn *tlb_fn)
 {
@@ -5805,20 +5892,21 @@ void sve_ldN_r_mte(CPUARMState *env, uint64_t *vg, target_ulong addr,
         mtedesc = 0;
     }
 
-    sve_ldN_r(env, vg, addr, desc, ra, esz, msz, N, mtedesc, host_fn, tlb_fn);
+    sve_ldN_r(env, vg, addr, desc, ra, esz, msz, N, mtedesc, le,
+              host_fn, tlb_fn);
 }
 
 #define DO_LD1_1(NAME, ESZ)                                             \
 void HELPER(sve_##NAME##_r)(CPUARMState *env, void *vg,                 \
                             target_ulong addr, uint32_t desc)           \
 {                                                                       \
-    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, MO_8, 1, 0,            \
+    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, MO_8, 1, 0, true,      \
               sve_##NAME##_host, sve_##NAME##_tlb);                     \
 }                                                                       \
 void HELPER(sve_##NAME##_r_mte)(CPUARMState *env, void *vg,             \
                                 target_ulong addr, uint32_t desc)       \
 {                                                                       \
-    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8, 1,           \
+    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8, 1, true,     \
                   sve_##NAME##_host, sve_##NAME##_tlb);                 \
 }
 
@@ -5826,25 +5914,25 @@ void HELPER(sve_##NAME##_r_mte)(CPUARMState *env, void *vg,             \
 void HELPER(sve_##NAME##_le_r)(CPUARMState *env, void *vg,              \
                                target_ulong addr, uint32_t desc)        \
 {                                                                       \
-    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1, 0,             \
+    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1, 0, true,       \
               sve_##NAME##_le_host, sve_##NAME##_le_tlb);               \
 }                                                                       \
 void HELPER(sve_##NAME##_be_r)(CPUARMState *env, void *vg,              \
                                target_ulong addr, uint32_t desc)        \
 {                                                                       \
-    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1, 0,             \
+    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1, 0, false,      \
               sve_##NAME##_be_host, sve_##NAME##_be_tlb);               \
 }                                                                       \
 void HELPER(sve_##NAME##_le_r_mte)(CPUARMState *env, void *vg,          \
                                    target_ulong addr, uint32_t desc)    \
 {                                                                       \
-    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1,            \
+    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1, true,      \
                   sve_##NAME##_le_host, sve_##NAME##_le_tlb);           \
 }                                                                       \
 void HELPER(sve_##NAME##_be_r_mte)(CPUARMState *env, void *vg,          \
                                    target_ulong addr, uint32_t desc)    \
 {                                                                       \
-    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1,            \
+    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, 1, false,     \
                   sve_##NAME##_be_host, sve_##NAME##_be_tlb);           \
 }
 
@@ -5875,13 +5963,13 @@ DO_LD1_2(ld1dd,  MO_64, MO_64)
 void HELPER(sve_ld##N##bb_r)(CPUARMState *env, void *vg,                \
                              target_ulong addr, uint32_t desc)          \
 {                                                                       \
-    sve_ldN_r(env, vg, addr, desc, GETPC(), MO_8, MO_8, N, 0,           \
+    sve_ldN_r(env, vg, addr, desc, GETPC(), MO_8, MO_8, N, 0, true,     \
               sve_ld1bb_host, sve_ld1bb_tlb);                           \
 }                                                                       \
 void HELPER(sve_ld##N##bb_r_mte)(CPUARMState *env, void *vg,            \
                                  target_ulong addr, uint32_t desc)      \
 {                                                                       \
-    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), MO_8, MO_8, N,          \
+    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), MO_8, MO_8, N, true,    \
                   sve_ld1bb_host, sve_ld1bb_tlb);                       \
 }
 
@@ -5889,25 +5977,25 @@ void HELPER(sve_ld##N##bb_r_mte)(CPUARMState *env, void *vg,            \
 void HELPER(sve_ld##N##SUFF##_le_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, ESZ, N, 0,             \
+    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, ESZ, N, 0, true,       \
               sve_ld1##SUFF##_le_host, sve_ld1##SUFF##_le_tlb);         \
 }                                                                       \
 void HELPER(sve_ld##N##SUFF##_be_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, ESZ, N, 0,             \
+    sve_ldN_r(env, vg, addr, desc, GETPC(), ESZ, ESZ, N, 0, false,      \
               sve_ld1##SUFF##_be_host, sve_ld1##SUFF##_be_tlb);         \
 }                                                                       \
 void HELPER(sve_ld##N##SUFF##_le_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, ESZ, N,            \
+    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, ESZ, N, true,      \
                   sve_ld1##SUFF##_le_host, sve_ld1##SUFF##_le_tlb);     \
 }                                                                       \
 void HELPER(sve_ld##N##SUFF##_be_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, ESZ, N,            \
+    sve_ldN_r_mte(env, vg, addr, desc, GETPC(), ESZ, ESZ, N, false,     \
                   sve_ld1##SUFF##_be_host, sve_ld1##SUFF##_be_tlb);     \
 }
 
@@ -5968,7 +6056,7 @@ static inline QEMU_ALWAYS_INLINE
 void sve_ldnfff1_r(CPUARMState *env, void *vg, const target_ulong addr,
                    uint32_t desc, const uintptr_t retaddr, uint32_t mtedesc,
                    const int esz, const int msz, const SVEContFault fault,
-                   sve_ldst1_host_fn *host_fn,
+                   const bool le, sve_ldst1_host_fn *host_fn,
                    sve_ldst1_tlb_fn *tlb_fn)
 {
     const unsigned rd = simd_data(desc);
@@ -6089,6 +6177,16 @@ void sve_ldnfff1_r(CPUARMState *env, void *vg, const target_ulong addr,
         goto do_fault;
     }
 
+    /*
+     * Without watchpoints or tag checks, no element on the page can
+     * fault, so the elements on it may be loaded all at once.
+     */
+    if (flags == 0 && !mtedesc &&
+        sve_cont_ldst_bulk_ok(addr, reg_max, esz, msz, 1, le)) {
+        sve_ld1_bulk(vd, vg, info.page[0].host, reg_max, esz);
+        return;
+    }
+
     reg_last = info.reg_off_last[0];
     host = info.page[0].host;
 
@@ -6146,7 +6244,7 @@ static inline QEMU_ALWAYS_INLINE
 void sve_ldnfff1_r_mte(CPUARMState *env, void *vg, target_ulong addr,
                        uint32_t desc, const uintptr_t retaddr,
                        const int esz, const int msz, const SVEContFault fault,
-                       sve_ldst1_host_fn *host_fn,
+                       const bool le, sve_ldst1_host_fn *host_fn,
                        sve_ldst1_tlb_fn *tlb_fn)
 {
     uint32_t mtedesc = desc >> (SIMD_DATA_SHIFT + SVE_MTEDESC_SHIFT);
@@ -6162,82 +6260,94 @@ void sve_ldnfff1_r_mte(CPUARMState *env, void *vg, target_ulong addr,
     }
 
     sve_ldnfff1_r(env, vg, addr, desc, retaddr, mtedesc,
-                  esz, msz, fault, host_fn, tlb_fn);
+                  esz, msz, fault, le, host_fn, tlb_fn);
 }
 
 #define DO_LDFF1_LDNF1_1(PART, ESZ)                                     \
 void HELPER(sve_ldff1##PART##_r)(CPUARMState *env, void *vg,            \
                                  target_ulong addr, uint32_t desc)      \
 {                                                                       \
-    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MO_8, FAULT_FIRST, \
+    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MO_8,           \
+                  FAULT_FIRST, true,                                    \
                   sve_ld1##PART##_host, sve_ld1##PART##_tlb);           \
 }                                                                       \
 void HELPER(sve_ldnf1##PART##_r)(CPUARMState *env, void *vg,            \
                                  target_ulong addr, uint32_t desc)      \
 {                                                                       \
-    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MO_8, FAULT_NO, \
+    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MO_8,           \
+                  FAULT_NO, true,                                       \
                   sve_ld1##PART##_host, sve_ld1##PART##_tlb);           \
 }                                                                       \
 void HELPER(sve_ldff1##PART##_r_mte)(CPUARMState *env, void *vg,        \
                                      target_ulong addr, uint32_t desc)  \
 {                                                                       \
-    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8, FAULT_FIRST, \
+    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8,          \
+                      FAULT_FIRST, true,                                \
                       sve_ld1##PART##_host, sve_ld1##PART##_tlb);       \
 }                                                                       \
 void HELPER(sve_ldnf1##PART##_r_mte)(CPUARMState *env, void *vg,        \
                                      target_ulong addr, uint32_t desc)  \
 {                                                                       \
-    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8, FAULT_NO, \
-                  sve_ld1##PART##_host, sve_ld1##PART##_tlb);           \
+    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8,          \
+                      FAULT_NO, true,                                   \
+                      sve_ld1##PART##_host, sve_ld1##PART##_tlb);       \
 }
 
 #define DO_LDFF1_LDNF1_2(PART, ESZ, MSZ)                                \
 void HELPER(sve_ldff1##PART##_le_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ, FAULT_FIRST, \
+    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ,            \
+                  FAULT_FIRST, true,                                    \
                   sve_ld1##PART##_le_host, sve_ld1##PART##_le_tlb);     \
 }                                                                       \
 void HELPER(sve_ldnf1##PART##_le_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ, FAULT_NO,  \
+    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ,            \
+                  FAULT_NO, true,                                       \
                   sve_ld1##PART##_le_host, sve_ld1##PART##_le_tlb);     \
 }                                                                       \
 void HELPER(sve_ldff1##PART##_be_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ, FAULT_FIRST, \
+    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ,            \
+                  FAULT_FIRST, false,                                   \
                   sve_ld1##PART##_be_host, sve_ld1##PART##_be_tlb);     \
 }                                                                       \
 void HELPER(sve_ldnf1##PART##_be_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ, FAULT_NO,  \
+    sve_ldnfff1_r(env, vg, addr, desc, GETPC(), 0, ESZ, MSZ,            \
+                  FAULT_NO, false,                                      \
                   sve_ld1##PART##_be_host, sve_ld1##PART##_be_tlb);     \
 }                                                                       \
 void HELPER(sve_ldff1##PART##_le_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, FAULT_FIRST, \
+    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ,           \
+                      FAULT_FIRST, true,                                \
                       sve_ld1##PART##_le_host, sve_ld1##PART##_le_tlb); \
 }                                                                       \
 void HELPER(sve_ldnf1##PART##_le_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, FAULT_NO, \
+    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ,           \
+                      FAULT_NO, true,                                   \
                       sve_ld1##PART##_le_host, sve_ld1##PART##_le_tlb); \
 }                                                                       \
 void HELPER(sve_ldff1##PART##_be_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, FAULT_FIRST, \
+    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ,           \
+                      FAULT_FIRST, false,                               \
                       sve_ld1##PART##_be_host, sve_ld1##PART##_be_tlb); \
 }                                                                       \
 void HELPER(sve_ldnf1##PART##_be_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, FAULT_NO, \
+    sve_ldnfff1_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ,           \
+                      FAULT_NO, false,                                  \
                       sve_ld1##PART##_be_host, sve_ld1##PART##_be_tlb); \
 }
 
@@ -6272,7 +6382,7 @@ static inline QEMU_ALWAYS_INLINE
 void sve_stN_r(CPUARMState *env, uint64_t *vg, target_ulong addr,
                uint32_t desc, const uintptr_t retaddr,
                const int esz, const int msz, const int N, uint32_t mtedesc,
-               sve_ldst1_host_fn *host_fn,
+               const bool le, sve_ldst1_host_fn *host_fn,
                sve_ldst1_tlb_fn *tlb_fn)
 {
     const unsigned rd = simd_data(desc);
@@ -6342,6 +6452,12 @@ void sve_stN_r(CPUARMState *env, uint64_t *vg, target_ulong addr,
 #endif
     }
 
+    if (sve_cont_ldst_bulk_ok(addr, reg_max, esz, msz, N, le)) {
+        sve_st1_bulk(&env->vfp.zregs[rd], vg, info.page[0].host,
+                     reg_max, esz, host_fn);
+        return;
+    }
+
     mem_off = info.mem_off_first[0];
     reg_off = info.reg_off_first[0];
     reg_last = info.reg_off_last[0];
@@ -6399,7 +6515,7 @@ void sve_stN_r(CPUARMState *env, uint64_t *vg, target_ulong addr,
 static inline QEMU_ALWAYS_INLINE
 void sve_stN_r_mte(CPUARMState *env, uint64_t *vg, target_ulong addr,
                    uint32_t desc, const uintptr_t ra,
-                   const int esz, const int msz, const int N,
+                   const int esz, const int msz, const int N, const bool le,
                    sve_ldst1_host_fn *host_fn,
                    sve_ldst1_tlb_fn *tlb_fn)
 {
@@ -6415,20 +6531,21 @@ void sve_stN_r_mte(CPUARMState *env, uint64_t *vg, target_ulong addr,
         mtedesc = 0;
     }
 
-    sve_stN_r(env, vg, addr, desc, ra, esz, msz, N, mtedesc, host_fn, tlb_fn);
+    sve_stN_r(env, vg, addr, desc, ra, esz, msz, N, mtedesc, le,
+              host_fn, tlb_fn);
 }
 
 #define DO_STN_1(N, NAME, ESZ)                                          \
 void HELPER(sve_st##N##NAME##_r)(CPUARMState *env, void *vg,            \
                                  target_ulong addr, uint32_t desc)      \
 {                                                                       \
-    sve_stN_r(env, vg, addr, desc, GETPC(), ESZ, MO_8, N, 0,            \
+    sve_stN_r(env, vg, addr, desc, GETPC(), ESZ, MO_8, N, 0, true,      \
               sve_st1##NAME##_host, sve_st1##NAME##_tlb);               \
 }                                                                       \
 void HELPER(sve_st##N##NAME##_r_mte)(CPUARMState *env, void *vg,        \
                                      target_ulong addr, uint32_t desc)  \
 {                                                                       \
-    sve_stN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8, N,           \
+    sve_stN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MO_8, N, true,     \
                   sve_st1##NAME##_host, sve_st1##NAME##_tlb);           \
 }
 
@@ -6436,25 +6553,25 @@ void HELPER(sve_st##N##NAME##_r_mte)(CPUARMState *env, void *vg,        \
 void HELPER(sve_st##N##NAME##_le_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_stN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, N, 0,             \
+    sve_stN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, N, 0, true,       \
               sve_st1##NAME##_le_host, sve_st1##NAME##_le_tlb);         \
 }                                                                       \
 void HELPER(sve_st##N##NAME##_be_r)(CPUARMState *env, void *vg,         \
                                     target_ulong addr, uint32_t desc)   \
 {                                                                       \
-    sve_stN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, N, 0,             \
+    sve_stN_r(env, vg, addr, desc, GETPC(), ESZ, MSZ, N, 0, false,      \
               sve_st1##NAME##_be_host, sve_st1##NAME##_be_tlb);         \
 }                                                                       \
 void HELPER(sve_st##N##NAME##_le_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_stN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, N,            \
+    sve_stN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, N, true,      \
                   sve_st1##NAME##_le_host, sve_st1##NAME##_le_tlb);     \
 }                                                                       \
 void HELPER(sve_st##N##NAME##_be_r_mte)(CPUARMState *env, void *vg,     \
                                         target_ulong addr, uint32_t desc) \
 {                                                                       \
-    sve_stN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, N,            \
+    sve_stN_r_mte(env, vg, addr, desc, GETPC(), ESZ, MSZ, N, false,     \
                   sve_st1##NAME##_be_host, sve_st1##NAME##_be_tlb);     \
 }
 
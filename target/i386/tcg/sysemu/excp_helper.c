@@ -36,6 +36,8 @@ typedef struct TranslateResult {
     hwaddr paddr;
     int prot;
     int page_size;
+    /* Size of the region around paddr that is mapped linearly. */
+    int map_size;
 } TranslateResult;
 
 typedef enum TranslateFaultStage2 {
@@ -146,7 +148,7 @@ static bool mmu_translate(CPUX86State *env, const TranslateParams *in,
     };
     hwaddr pte_addr, paddr;
     uint32_t pkr;
-    int page_size;
+    int page_size, map_size;
     int error_code;
 
  restart_all:
@@ -418,6 +420,7 @@ do_check_protect_pse36:
 
     /* merge offset within page */
     paddr = (pte & PG_ADDRESS_MASK & ~(page_size - 1)) | (addr & (page_size - 1));
+    map_size = page_size;
 
     /*
      * Note that NPT is walked (for both paging structures and final guest
@@ -454,8 +457,9 @@ do_check_protect_pse36:
 
         /*
          * Use the larger of stage1 & stage2 page sizes, so that
-         * invalidation works.
+         * invalidation works.  Only the smaller is mapped linearly.
          */
+        map_size = MIN(page_size, nested_page_size);
         if (nested_page_size > page_size) {
             page_size = nested_page_size;
         }
@@ -464,6 +468,8 @@ do_check_protect_pse36:
     out->paddr = paddr & x86_get_a20_mask(env);
     out->prot = prot;
     out->page_size = page_size;
+    /* With A20 masked, bit 20 breaks up any page larger than 1MB. */
+    out->map_size = x86_get_a20_mask(env) == -1 ? map_size : TARGET_PAGE_SIZE;
     return true;
 
  do_fault_rsvd:
@@ -586,6 +592,7 @@ static bool get_physical_address(CPUX86State *env, vaddr addr,
     out->paddr = addr & x86_get_a20_mask(env);
     out->prot = PAGE_READ | PAGE_WRITE | PAGE_EXEC;
     out->page_size = TARGET_PAGE_SIZE;
+    out->map_size = TARGET_PAGE_SIZE;
     return true;
 }
 
@@ -600,13 +607,19 @@ bool x86_cpu_tlb_fill(CPUState *cs, vaddr addr, int size,
     if (get_physical_address(env, addr, access_type, mmu_idx, &out, &err)) {
         /*
          * Even if 4MB pages, we map only one 4KB page in the cache to
-         * avoid filling it too fast.
+         * avoid filling it too fast.  The rest of a large page can be
+         * filled from the translation remembered via lg_map_size.
          */
+        CPUTLBEntryFull full = {
+            .phys_addr = out.paddr & TARGET_PAGE_MASK,
+            .attrs = cpu_get_mem_attrs(env),
+            .prot = out.prot,
+            .lg_page_size = ctz32(out.page_size),
+            .lg_map_size = ctz32(out.map_size),
+        };
+
         assert(out.prot & (1 << access_type));
-        tlb_set_page_with_attrs(cs, addr & TARGET_PAGE_MASK,
-                                out.paddr & TARGET_PAGE_MASK,
-                                cpu_get_mem_attrs(env),
-                                out.prot, mmu_idx, out.page_size);
+        tlb_set_page_full(cs, mmu_idx, addr & TARGET_PAGE_MASK, &full);
         return true;
     }
 
@@ -261,17 +261,65 @@ GEN_VEXT_ST_STRIDE(vsse64_v, int64_t, ste_d)
  * unit-stride: access elements stored contiguously in memory
  */
 
+/*
+ * Copy the elements of an unmasked unit-stride access with NF == 1 that
+ * lie in RAM straight between guest memory and the register file, one
+ * page at a time, starting at vstart.  vstart is left at the first element
+ * that could not be copied this way: one that crosses a page boundary, or
+ * one in a page that is not backed by host memory.
+ *
+ * On a big-endian host the elements in the register file are swizzled
+ * (see H1 and friends), so only the element-wise loop can be used there.
+ */
+static void
+vext_ldst_us_host(void *vd, target_ulong base, CPURISCVState *env,
+                  uint32_t log2_esz, uint32_t evl,
+                  MMUAccessType access_type, uintptr_t ra)
+{
+#if !HOST_BIG_ENDIAN
+    int mmu_index = riscv_env_mmu_index(env, false);
+
+    while (env->vstart < evl) {
+        target_ulong addr = adjust_addr(env,
+                                        base + (env->vstart << log2_esz));
+        uint32_t elems = MIN(evl - env->vstart,
+                             -(addr | TARGET_PAGE_MASK) >> log2_esz);
+        uint32_t len = elems << log2_esz;
+        uint8_t *reg = (uint8_t *)vd + (env->vstart << log2_esz);
+        void *host;
+
+        if (elems == 0) {
+            return;
+        }
+        host = probe_access(env, addr, len, access_type, mmu_index, ra);
+        if (host == NULL) {
+            return;
+        }
+        if (access_type == MMU_DATA_LOAD) {
+            memcpy(reg, host, len);
+        } else {
+            memcpy(host, reg, len);
+        }
+        env->vstart += elems;
+    }
+#endif
+}
+
 /* unmasked unit-stride load and store operation */
 static void
 vext_ldst_us(void *vd, target_ulong base, CPURISCVState *env, uint32_t desc,
              vext_ldst_elem_fn *ldst_elem, uint32_t log2_esz, uint32_t evl,
-             uintptr_t ra)
+             MMUAccessType access_type, uintptr_t ra)
 {
     uint32_t i, k;
     uint32_t nf = vext_nf(desc);
     uint32_t max_elems = vext_max_elems(desc, log2_esz);
     uint32_t esz = 1 << log2_esz;
 
+    if (nf == 1) {
+        vext_ldst_us_host(vd, base, env, log2_esz, evl, access_type, ra);
+    }
+
     /* load bytes from guest memory */
     for (i = env->vstart; i < evl; i++, env->vstart++) {
         k = 0;
@@ -304,7 +352,7 @@ void HELPER(NAME)(void *vd, void *v0, target_ulong base,                \
                   CPURISCVState *env, uint32_t desc)                    \
 {                                                                       \
     vext_ldst_us(vd, base, env, desc, LOAD_FN,                          \
-                 ctzl(sizeof(ETYPE)), env->vl, GETPC());                \
+                 ctzl(sizeof(ETYPE)), env->vl, MMU_DATA_LOAD, GETPC()); \
 }
 
 GEN_VEXT_LD_US(vle8_v,  int8_t,  lde_b)
@@ -325,7 +373,7 @@ void HELPER(NAME)(void *vd, void *v0, target_ulong base,                 \
                   CPURISCVState *env, uint32_t desc)                     \
 {                                                                        \
     vext_ldst_us(vd, base, env, desc, STORE_FN,                          \
-                 ctzl(sizeof(ETYPE)), env->vl, GETPC());                 \
+                 ctzl(sizeof(ETYPE)), env->vl, MMU_DATA_STORE, GETPC()); \
 }
 
 GEN_VEXT_ST_US(vse8_v,  int8_t,  ste_b)
@@ -342,7 +390,7 @@ void HELPER(vlm_v)(void *vd, void *v0, target_ulong base,
     /* evl = ceil(vl/8) */
     uint8_t evl = (env->vl + 7) >> 3;
     vext_ldst_us(vd, base, env, desc, lde_b,
-                 0, evl, GETPC());
+                 0, evl, MMU_DATA_LOAD, GETPC());
 }
 
 void HELPER(vsm_v)(void *vd, void *v0, target_ulong base,
@@ -351,7 +399,7 @@ void HELPER(vsm_v)(void *vd, void *v0, target_ulong base,
     /* evl = ceil(vl/8) */
     uint8_t evl = (env->vl + 7) >> 3;
     vext_ldst_us(vd, base, env, desc, ste_b,
-                 0, evl, GETPC());
+                 0, evl, MMU_DATA_STORE, GETPC());
 }
 
 /*
@@ -53,8 +53,31 @@ typedef struct TempOptInfo {
     uint64_t val;
     uint64_t z_mask;  /* mask bit is 0 if and only if value bit is 0 */
     uint64_t s_mask;  /* a left-aligned mask of clrsb(value) bits. */
+    unsigned gen;     /* incremented each time the value changes */
 } TempOptInfo;
 
+/*
+ * Common subexpression elimination.  Pure opcodes, and optionally guest
+ * loads, are entered into a small direct-mapped table keyed by opcode and
+ * by the canonical copies of their inputs.  Entries record the generation
+ * of each temp involved, so that overwriting a temp implicitly kills the
+ * entries that refer to it; the whole table is dropped at the end of each
+ * extended basic block by bumping the epoch.
+ */
+#define CSE_TABLE_BITS  7
+#define CSE_MAX_IARGS   4
+#define CSE_MAX_CARGS   2
+
+typedef struct CSEEntry {
+    TCGOpcode opc;
+    unsigned epoch;
+    unsigned ld_epoch;
+    unsigned out_gen;
+    TCGTemp *out;
+    TCGArg args[CSE_MAX_IARGS + CSE_MAX_CARGS];
+    unsigned gens[CSE_MAX_IARGS];
+} CSEEntry;
+
 typedef struct OptContext {
     TCGContext *tcg;
     TCGOp *prev_mb;
@@ -63,6 +86,11 @@ typedef struct OptContext {
     IntervalTreeRoot mem_copy;
     QSIMPLEQ_HEAD(, MemCopyInfo) mem_free;
 
+    /* CSE table, or NULL if disabled; see TCG_OPT_CSE. */
+    CSEEntry *cse;
+    unsigned cse_epoch;  /* bumped at the end of each extended BB */
+    unsigned ld_epoch;   /* bumped by anything that may write guest memory */
+
     /* In flight values from optimization. */
     uint64_t a_mask;  /* mask bit is 0 iff value identical to first input */
     uint64_t z_mask;  /* mask bit is 0 iff value bit is 0 */
@@ -164,6 +192,7 @@ static void init_ts_info(OptContext *ctx, TCGTemp *ts)
     ti = ts->state_ptr;
     if (ti == NULL) {
         ti = tcg_malloc(sizeof(TempOptInfo));
+        ti->gen = 0;
         ts->state_ptr = ti;
     }
 
@@ -266,6 +295,7 @@ static void reset_ts(OptContext *ctx, TCGTemp *ts)
     ti->is_const = false;
     ti->z_mask = -1;
     ti->s_mask = 0;
+    ti->gen++;
 
     if (!QSIMPLEQ_EMPTY(&ti->mem_copy)) {
         if (ts == nts) {
@@ -978,6 +1008,7 @@ static void finish_folding(OptContext *ctx, TCGOp *op)
         if (!(def->flags & TCG_OPF_COND_BRANCH)) {
             memset(&ctx->temps_used, 0, sizeof(ctx->temps_used));
             remove_mem_copy_all(ctx);
+            ctx->cse_epoch++;
         }
         return;
     }
@@ -1528,6 +1559,7 @@ static bool fold_call(OptContext *ctx, TCGOp *op)
     /* If the function has side effects, reset mem data. */
     if (!(flags & TCG_CALL_NO_SIDE_EFFECTS)) {
         remove_mem_copy_all(ctx);
+        ctx->ld_epoch++;
     }
 
     /* Reset temp data for outputs. */
@@ -1820,6 +1852,9 @@ static bool fold_extu(OptContext *ctx, TCGOp *op)
 
 static bool fold_mb(OptContext *ctx, TCGOp *op)
 {
+    /* Guest loads must not be merged across a barrier.  */
+    ctx->ld_epoch++;
+
     /* Eliminate duplicate and redundant fence instructions.  */
     if (ctx->prev_mb) {
         /*
@@ -2088,6 +2123,8 @@ static bool fold_qemu_st(OptContext *ctx, TCGOp *op)
 {
     /* Opcodes that touch guest memory stop the mb optimization.  */
     ctx->prev_mb = NULL;
+    /* The store may alias any previously loaded address.  */
+    ctx->ld_epoch++;
     return false;
 }
 
@@ -2594,6 +2631,165 @@ static bool fold_xor(OptContext *ctx, TCGOp *op)
 }
 
 /* Propagate constants and copies, fold constant expressions. */
+static bool cse_is_load(TCGOpcode opc)
+{
+    switch (opc) {
+    case INDEX_op_qemu_ld_a32_i32:
+    case INDEX_op_qemu_ld_a64_i32:
+    case INDEX_op_qemu_ld_a32_i64:
+    case INDEX_op_qemu_ld_a64_i64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Return true if OP may be entered into the CSE table.  */
+static bool cse_op_ok(OptContext *ctx, TCGOp *op)
+{
+    const TCGOpDef *def = &tcg_op_defs[op->opc];
+
+    if (def->nb_oargs != 1
+        || def->nb_iargs > CSE_MAX_IARGS
+        || def->nb_cargs > CSE_MAX_CARGS) {
+        return false;
+    }
+
+    switch (op->opc) {
+    CASE_OP_32_64(mov):
+    CASE_OP_32_64(ld8u):
+    CASE_OP_32_64(ld8s):
+    CASE_OP_32_64(ld16u):
+    CASE_OP_32_64(ld16s):
+    case INDEX_op_ld_i32:
+    case INDEX_op_ld32u_i64:
+    case INDEX_op_ld32s_i64:
+    case INDEX_op_ld_i64:
+        /* Loads from env are handled by the mem_copy tracking.  */
+        return false;
+    default:
+        break;
+    }
+
+    if (cse_is_load(op->opc)) {
+        /*
+         * A guest load is only redundant if nothing could have written
+         * guest memory since the previous one.  Note that this also
+         * merges back-to-back reads of the same MMIO register, which is
+         * why it is enabled separately.
+         */
+        return ctx->tcg->opt_flags & TCG_OPT_CSE_LD;
+    }
+    return (ctx->tcg->opt_flags & TCG_OPT_CSE)
+        && !(def->flags & (TCG_OPF_BB_END | TCG_OPF_CALL_CLOBBER |
+                           TCG_OPF_SIDE_EFFECTS | TCG_OPF_NOT_PRESENT |
+                           TCG_OPF_VECTOR));
+}
+
+static CSEEntry *cse_slot(OptContext *ctx, TCGOp *op)
+{
+    const TCGOpDef *def = &tcg_op_defs[op->opc];
+    int nb_args = def->nb_iargs + def->nb_cargs;
+    uint64_t h = op->opc;
+
+    for (int i = 0; i < nb_args; i++) {
+        h = (h + op->args[1 + i]) * 0x9e3779b97f4a7c15ull;
+    }
+    return &ctx->cse[h >> (64 - CSE_TABLE_BITS)];
+}
+
+/* Return true if E holds a still valid copy of the result of OP.  */
+static bool cse_match(OptContext *ctx, CSEEntry *e, TCGOp *op)
+{
+    const TCGOpDef *def = &tcg_op_defs[op->opc];
+    int nb_iargs = def->nb_iargs;
+    int nb_args = nb_iargs + def->nb_cargs;
+
+    if (e->epoch != ctx->cse_epoch || e->opc != op->opc) {
+        return false;
+    }
+    if (cse_is_load(op->opc) && e->ld_epoch != ctx->ld_epoch) {
+        return false;
+    }
+    if (ts_info(e->out)->gen != e->out_gen) {
+        return false;
+    }
+    for (int i = 0; i < nb_args; i++) {
+        if (e->args[i] != op->args[1 + i]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < nb_iargs; i++) {
+        if (e->gens[i] != arg_info(op->args[1 + i])->gen) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Record the inputs of OP into E; the output is filled in afterward.  */
+static void cse_record(OptContext *ctx, CSEEntry *e, TCGOp *op)
+{
+    const TCGOpDef *def = &tcg_op_defs[op->opc];
+    int nb_iargs = def->nb_iargs;
+    int nb_args = nb_iargs + def->nb_cargs;
+
+    e->opc = op->opc;
+    e->epoch = ctx->cse_epoch;
+    e->ld_epoch = ctx->ld_epoch;
+    for (int i = 0; i < nb_args; i++) {
+        e->args[i] = op->args[1 + i];
+    }
+    for (int i = 0; i < nb_iargs; i++) {
+        e->gens[i] = arg_info(op->args[1 + i])->gen;
+    }
+}
+
+/* Replace OP with a copy of an identical earlier result, if there is one. */
+static bool fold_cse(OptContext *ctx, TCGOp *op, CSEEntry **pe)
+{
+    TCGContext *s = ctx->tcg;
+    CSEEntry *e;
+
+    *pe = NULL;
+    if (!ctx->cse || !cse_op_ok(ctx, op)) {
+        return false;
+    }
+
+    e = cse_slot(ctx, op);
+    if (cse_match(ctx, e, op)) {
+        if (cse_is_load(op->opc)) {
+            qatomic_set(&s->opt_ld_count, s->opt_ld_count + 1);
+        } else {
+            qatomic_set(&s->opt_cse_count, s->opt_cse_count + 1);
+        }
+        return tcg_opt_gen_mov(ctx, op, op->args[0], temp_arg(e->out));
+    }
+
+    /* The input generations must be sampled before the output is reset. */
+    cse_record(ctx, e, op);
+    *pe = e;
+    return false;
+}
+
+/*
+ * Return the number of operations and guest loads removed by CSE,
+ * summed over all TCG contexts.
+ */
+void tcg_optimize_counts(size_t *cse, size_t *ld)
+{
+    unsigned int n_ctxs = qatomic_read(&tcg_cur_ctxs);
+
+    *cse = 0;
+    *ld = 0;
+    for (unsigned int i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = qatomic_read(&tcg_ctxs[i]);
+
+        *cse += qatomic_read(&s->opt_cse_count);
+        *ld += qatomic_read(&s->opt_ld_count);
+    }
+}
+
 void tcg_optimize(TCGContext *s)
 {
     int nb_temps, i;
@@ -2602,6 +2798,15 @@ void tcg_optimize(TCGContext *s)
 
     QSIMPLEQ_INIT(&ctx.mem_free);
 
+    if (s->opt_flags & (TCG_OPT_CSE | TCG_OPT_CSE_LD)) {
+        size_t size = sizeof(CSEEntry) << CSE_TABLE_BITS;
+
+        /* Epoch 0 marks the entries as unused. */
+        ctx.cse = tcg_malloc(size);
+        memset(ctx.cse, 0, size);
+        ctx.cse_epoch = 1;
+    }
+
     /* Array VALS has an element for each temp.
        If this temp holds a constant then its value is kept in VALS' element.
        If this temp is a copy of other ones then the other copies are
@@ -2834,7 +3039,16 @@ void tcg_optimize(TCGContext *s)
         }
 
         if (!done) {
+            CSEEntry *e;
+
+            if (fold_cse(&ctx, op, &e)) {
+                continue;
+            }
             finish_folding(&ctx, op);
+            if (e) {
+                e->out = arg_temp(op->args[0]);
+                e->out_gen = ts_info(e->out)->gen;
+            }
         }
     }
 }
@@ -24,6 +24,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/units.h"
+#include "qemu/bitops.h"
 #include "qemu/madvise.h"
 #include "qemu/mprotect.h"
 #include "qemu/memalign.h"
@@ -31,9 +32,14 @@
 #include "qemu/qtree.h"
 #include "qapi/error.h"
 #include "tcg/tcg.h"
+#include "tcg/startup.h"
 #include "exec/translation-block.h"
 #include "tcg-internal.h"
 #include "host/cpuinfo.h"
+#ifdef CONFIG_LINUX
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 
 /*
@@ -69,8 +75,18 @@ struct tcg_region_state {
     size_t stride; /* .size + guard size */
     size_t total_size; /* size of entire buffer, >= n * stride */
 
-    /* fields protected by the lock */
-    size_t current; /* current region index */
+    bool evict; /* retire the oldest regions instead of resetting all */
+    bool numa; /* bind each region to the NUMA node of its context */
+
+    /*
+     * fields protected by the lock
+     * Regions are handed out round-robin: oldest and current count
+     * allocations, and region (i % n) is in use for oldest <= i < current.
+     * Without eviction, oldest stays 0 until the next reset.
+     */
+    size_t oldest;
+    size_t current;
+    size_t n_evicting; /* regions being evicted, starting at oldest */
     size_t agg_size_full; /* aggregate size of full regions */
 };
 
@@ -191,10 +207,8 @@ static void tcg_region_trees_init(void)
     }
 }
 
-static struct tcg_region_tree *tc_ptr_to_region_tree(const void *p)
+static bool tc_ptr_to_region_idx(const void *p, size_t *pidx)
 {
-    size_t region_idx;
-
     /*
      * Like tcg_splitwx_to_rw, with no assert.  The pc may come from
      * a signal handler over which the caller has no control.
@@ -202,21 +216,31 @@ static struct tcg_region_tree *tc_ptr_to_region_tree(const void *p)
     if (!in_code_gen_buffer(p)) {
         p -= tcg_splitwx_diff;
         if (!in_code_gen_buffer(p)) {
-            return NULL;
+            return false;
         }
     }
 
     if (p < region.start_aligned) {
-        region_idx = 0;
+        *pidx = 0;
     } else {
         ptrdiff_t offset = p - region.start_aligned;
 
         if (offset > region.stride * (region.n - 1)) {
-            region_idx = region.n - 1;
+            *pidx = region.n - 1;
         } else {
-            region_idx = offset / region.stride;
+            *pidx = offset / region.stride;
         }
     }
+    return true;
+}
+
+static struct tcg_region_tree *tc_ptr_to_region_tree(const void *p)
+{
+    size_t region_idx;
+
+    if (!tc_ptr_to_region_idx(p, &region_idx)) {
+        return NULL;
+    }
     return region_trees + region_idx * tree_size;
 }
 
@@ -311,6 +335,13 @@ size_t tcg_nb_tbs(void)
     return nb_tbs;
 }
 
+static void tcg_region_tree_reset(struct tcg_region_tree *rt)
+{
+    /* Increment the refcount first so that destroy acts as a reset */
+    q_tree_ref(rt->tree);
+    q_tree_destroy(rt->tree);
+}
+
 static void tcg_region_tree_reset_all(void)
 {
     size_t i;
@@ -319,9 +350,7 @@ static void tcg_region_tree_reset_all(void)
     for (i = 0; i < region.n; i++) {
         struct tcg_region_tree *rt = region_trees + i * tree_size;
 
-        /* Increment the refcount first so that destroy acts as a reset */
-        q_tree_ref(rt->tree);
-        q_tree_destroy(rt->tree);
+        tcg_region_tree_reset(rt);
     }
     tcg_region_tree_unlock_all();
 }
@@ -345,11 +374,51 @@ static void tcg_region_bounds(size_t curr_region, void **pstart, void **pend)
     *pend = end;
 }
 
+/*
+ * NUMA nodes beyond this are left to the default policy; the array is
+ * small enough to live on the stack.
+ */
+#define TCG_REGION_MAX_NODES 1024
+
+/* Return the host NUMA node the calling thread runs on, or -1. */
+static int tcg_region_host_node(void)
+{
+#if defined(CONFIG_LINUX) && defined(SYS_getcpu)
+    unsigned cpu, node;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 &&
+        node < TCG_REGION_MAX_NODES) {
+        return node;
+    }
+#endif
+    return -1;
+}
+
+/*
+ * Prefer memory from @node for [@start, @end), and move the pages that
+ * a previous user of the region touched.  This is only a hint, so
+ * failures are ignored.
+ */
+static void tcg_region_bind(void *start, void *end, int node)
+{
+#if defined(CONFIG_LINUX) && defined(SYS_mbind)
+    unsigned long nodes[BITS_TO_LONGS(TCG_REGION_MAX_NODES)] = { };
+
+    start = QEMU_ALIGN_PTR_DOWN(start, qemu_real_host_page_size());
+    set_bit(node, nodes);
+    (void)syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, nodes,
+                  TCG_REGION_MAX_NODES + 1, MPOL_MF_MOVE);
+#endif
+}
+
 static void tcg_region_assign(TCGContext *s, size_t curr_region)
 {
     void *start, *end;
 
     tcg_region_bounds(curr_region, &start, &end);
+    if (region.numa && s->code_gen_node >= 0) {
+        tcg_region_bind(start, end, s->code_gen_node);
+    }
 
     s->code_gen_buffer = start;
     s->code_gen_ptr = start;
@@ -359,10 +428,10 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
-    if (region.current == region.n) {
+    if (region.current - region.oldest == region.n) {
         return true;
     }
-    tcg_region_assign(s, region.current);
+    tcg_region_assign(s, region.current % region.n);
     region.current++;
     return false;
 }
@@ -396,8 +465,11 @@ static void tcg_region_initial_alloc__locked(TCGContext *s)
     g_assert(!err);
 }
 
+/* Called from the thread that is going to use @s. */
 void tcg_region_initial_alloc(TCGContext *s)
 {
+    s->code_gen_node = region.numa ? tcg_region_host_node() : -1;
+
     qemu_mutex_lock(&region.lock);
     tcg_region_initial_alloc__locked(s);
     qemu_mutex_unlock(&region.lock);
@@ -410,7 +482,9 @@ void tcg_region_reset_all(void)
     unsigned int i;
 
     qemu_mutex_lock(&region.lock);
+    region.oldest = 0;
     region.current = 0;
+    region.n_evicting = 0;
     region.agg_size_full = 0;
 
     for (i = 0; i < n_ctxs; i++) {
@@ -422,6 +496,114 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
+/*
+ * Generational eviction: when the buffer is full, retire the oldest
+ * TCG_REGION_EVICT_DIV-th of the regions and keep the translations in
+ * the others.  Hot code that was in the retired regions is translated
+ * again into the youngest ones.
+ *
+ * All of this must be called from a safe-work context.  The caller
+ * unpublishes each TB returned by tcg_region_evict_foreach() between
+ * tcg_region_evict_prepare() and tcg_region_evict_commit().
+ */
+#define TCG_REGION_EVICT_DIV 4
+
+/*
+ * With eviction enabled, use at least this many regions even when a
+ * single TCG context would otherwise get away with one.
+ */
+#define TCG_REGION_EVICT_MIN 8
+
+/* Return true if full buffers evict regions rather than reset them all */
+bool tcg_region_evict_enabled(void)
+{
+    return region.evict;
+}
+
+/* Returns the number of regions to be evicted, 0 if a reset is needed */
+size_t tcg_region_evict_prepare(void)
+{
+    size_t n = 0;
+
+    qemu_mutex_lock(&region.lock);
+    if (region.evict && region.n > 1) {
+        n = MAX(region.n / TCG_REGION_EVICT_DIV, 1);
+        n = MIN(n, region.current - region.oldest);
+    }
+    region.n_evicting = n;
+    qemu_mutex_unlock(&region.lock);
+    return n;
+}
+
+/* Return true if @p points into a region being evicted */
+bool tcg_region_evicting(const void *p)
+{
+    size_t idx;
+
+    if (!region.n_evicting || !tc_ptr_to_region_idx(p, &idx)) {
+        return false;
+    }
+    idx = (idx + region.n - region.oldest % region.n) % region.n;
+    return idx < region.n_evicting;
+}
+
+void tcg_region_evict_foreach(GTraverseFunc func, gpointer user_data)
+{
+    size_t i;
+
+    for (i = 0; i < region.n_evicting; i++) {
+        size_t idx = (region.oldest + i) % region.n;
+        struct tcg_region_tree *rt = region_trees + idx * tree_size;
+
+        qemu_mutex_lock(&rt->lock);
+        q_tree_foreach(rt->tree, func, user_data);
+        qemu_mutex_unlock(&rt->lock);
+    }
+}
+
+void tcg_region_evict_commit(void)
+{
+    unsigned int n_ctxs = qatomic_read(&tcg_cur_ctxs);
+    g_autofree bool *moved = g_new0(bool, n_ctxs);
+    unsigned int i;
+
+    qemu_mutex_lock(&region.lock);
+
+    for (i = 0; i < region.n_evicting; i++) {
+        size_t idx = (region.oldest + i) % region.n;
+        struct tcg_region_tree *rt = region_trees + idx * tree_size;
+        void *start, *end;
+
+        tcg_region_bounds(idx, &start, &end);
+        region.agg_size_full -= end - start - TCG_HIGHWATER;
+
+        qemu_mutex_lock(&rt->lock);
+        tcg_region_tree_reset(rt);
+        qemu_mutex_unlock(&rt->lock);
+    }
+
+    /* Regions still in use were not accounted as full, see above. */
+    for (i = 0; i < n_ctxs; i++) {
+        TCGContext *s = qatomic_read(&tcg_ctxs[i]);
+
+        if (tcg_region_evicting(s->code_gen_buffer)) {
+            region.agg_size_full += s->code_gen_buffer_size - TCG_HIGHWATER;
+            moved[i] = true;
+        }
+    }
+
+    region.oldest += region.n_evicting;
+    region.n_evicting = 0;
+
+    for (i = 0; i < n_ctxs; i++) {
+        if (moved[i]) {
+            tcg_region_initial_alloc__locked(qatomic_read(&tcg_ctxs[i]));
+        }
+    }
+
+    qemu_mutex_unlock(&region.lock);
+}
+
 static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
 {
 #ifdef CONFIG_USER_ONLY
@@ -499,7 +681,8 @@ static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
 static uint8_t static_code_gen_buffer[DEFAULT_CODE_GEN_BUFFER_SIZE]
     __attribute__((aligned(CODE_GEN_ALIGN)));
 
-static int alloc_code_gen_buffer(size_t tb_size, int splitwx, Error **errp)
+static int alloc_code_gen_buffer(size_t tb_size, int splitwx, bool huge,
+                                 Error **errp)
 {
     void *buf, *end;
     size_t size;
@@ -528,7 +711,8 @@ static int alloc_code_gen_buffer(size_t tb_size, int splitwx, Error **errp)
     return PROT_READ | PROT_WRITE;
 }
 #elif defined(_WIN32)
-static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
+static int alloc_code_gen_buffer(size_t size, int splitwx, bool huge,
+                                 Error **errp)
 {
     void *buf;
 
@@ -572,7 +756,37 @@ static int alloc_code_gen_buffer_anon(size_t size, int prot,
 #ifdef CONFIG_POSIX
 #include "qemu/memfd.h"
 
-static int alloc_code_gen_buffer_splitwx_memfd(size_t size, Error **errp)
+/*
+ * Map @fd at an address aligned to QEMU_VMALLOC_ALIGN.  A shared mapping
+ * can only use huge pages where the address and the file offset agree
+ * modulo the huge page size, so the rw and rx views must both start
+ * aligned for either of them to get huge pages.
+ */
+static void *mmap_shared_aligned(size_t size, int prot, int fd)
+{
+    const size_t align = QEMU_VMALLOC_ALIGN;
+    void *buf, *aligned, *ret;
+
+    buf = mmap(NULL, size + align, PROT_NONE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        return MAP_FAILED;
+    }
+    aligned = QEMU_ALIGN_PTR_UP(buf, align);
+    if (aligned != buf) {
+        munmap(buf, aligned - buf);
+    }
+    munmap(aligned + size, buf + align - aligned);
+
+    ret = mmap(aligned, size, prot, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (ret == MAP_FAILED) {
+        munmap(aligned, size);
+    }
+    return ret;
+}
+
+static int alloc_code_gen_buffer_splitwx_memfd(size_t size, bool huge,
+                                               Error **errp)
 {
     void *buf_rw = NULL, *buf_rx = MAP_FAILED;
     int fd = -1;
@@ -581,8 +795,21 @@ static int alloc_code_gen_buffer_splitwx_memfd(size_t size, Error **errp)
     if (buf_rw == NULL) {
         goto fail;
     }
+    if (huge && !QEMU_PTR_IS_ALIGNED(buf_rw, QEMU_VMALLOC_ALIGN)) {
+        void *buf = mmap_shared_aligned(size, PROT_READ | PROT_WRITE, fd);
+
+        /* Not fatal: only huge pages are lost. */
+        if (buf != MAP_FAILED) {
+            munmap(buf_rw, size);
+            buf_rw = buf;
+        }
+    }
 
-    buf_rx = mmap(NULL, size, host_prot_read_exec(), MAP_SHARED, fd, 0);
+    if (huge) {
+        buf_rx = mmap_shared_aligned(size, host_prot_read_exec(), fd);
+    } else {
+        buf_rx = mmap(NULL, size, host_prot_read_exec(), MAP_SHARED, fd, 0);
+    }
     if (buf_rx == MAP_FAILED) {
         error_setg_errno(errp, errno,
                          "failed to map shared memory for execute");
@@ -668,27 +895,29 @@ static int alloc_code_gen_buffer_splitwx_vmremap(size_t size, Error **errp)
 #endif /* CONFIG_DARWIN */
 #endif /* CONFIG_TCG_INTERPRETER */
 
-static int alloc_code_gen_buffer_splitwx(size_t size, Error **errp)
+static int alloc_code_gen_buffer_splitwx(size_t size, bool huge,
+                                         Error **errp)
 {
 #ifndef CONFIG_TCG_INTERPRETER
 # ifdef CONFIG_DARWIN
     return alloc_code_gen_buffer_splitwx_vmremap(size, errp);
 # endif
 # ifdef CONFIG_POSIX
-    return alloc_code_gen_buffer_splitwx_memfd(size, errp);
+    return alloc_code_gen_buffer_splitwx_memfd(size, huge, errp);
 # endif
 #endif
     error_setg(errp, "jit split-wx not supported");
     return -1;
 }
 
-static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
+static int alloc_code_gen_buffer(size_t size, int splitwx, bool huge,
+                                 Error **errp)
 {
     ERRP_GUARD();
     int prot, flags;
 
     if (splitwx) {
-        prot = alloc_code_gen_buffer_splitwx(size, errp);
+        prot = alloc_code_gen_buffer_splitwx(size, huge, errp);
         if (prot >= 0) {
             return prot;
         }
@@ -749,9 +978,12 @@ static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
  * in practice. Multi-threaded guests share most if not all of their translated
  * code, which makes parallel code generation less appealing than in system-mode
  */
-void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
+void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus,
+                     unsigned flags)
 {
     const size_t page_size = qemu_real_host_page_size();
+    const size_t huge_page_size = QEMU_VMALLOC_ALIGN;
+    bool huge = (flags & TCG_INIT_HUGEPAGES) && huge_page_size > page_size;
     size_t region_size;
     int have_prot, need_prot;
 
@@ -772,8 +1004,29 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
         tb_size = MAX_CODE_GEN_BUFFER_SIZE;
     }
 
-    have_prot = alloc_code_gen_buffer(tb_size, splitwx, &error_fatal);
+    /*
+     * With huge pages, allocate some slack and trim the buffer to whole
+     * huge pages, so that no region shares one with its neighbours.
+     * With split-wx, both views are then mapped at aligned addresses
+     * (see mmap_shared_aligned), so the rx alias of the trimmed buffer
+     * is aligned as well.
+     */
+    have_prot = alloc_code_gen_buffer(tb_size + (huge ? 2 * huge_page_size : 0),
+                                      splitwx, huge, &error_fatal);
     assert(have_prot >= 0);
+    if (huge) {
+        void *start = QEMU_ALIGN_PTR_UP(region.start_aligned, huge_page_size);
+        void *end = QEMU_ALIGN_PTR_DOWN(region.start_aligned +
+                                        region.total_size, huge_page_size);
+
+        /* Keep the buffer within MAX_CODE_GEN_BUFFER_SIZE. */
+        if (end - start >= tb_size) {
+            region.start_aligned = start;
+            region.total_size = tb_size;
+        } else {
+            huge = false;
+        }
+    }
 
     /* Request large pages for the buffer and the splitwx.  */
     qemu_madvise(region.start_aligned, region.total_size, QEMU_MADV_HUGEPAGE);
@@ -788,8 +1041,19 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
      * the buffer; we will assign those to the last region.
      */
     region.n = tcg_n_regions(tb_size, max_cpus);
+    region.evict = flags & TCG_INIT_EVICT;
+    region.numa = flags & TCG_INIT_NUMA;
+    if (region.evict) {
+        region.n = MAX(region.n,
+                       MIN(TCG_REGION_EVICT_MIN, tb_size / (2 * MiB)));
+    }
     region_size = tb_size / region.n;
-    region_size = QEMU_ALIGN_DOWN(region_size, page_size);
+    if (huge && region_size >= huge_page_size) {
+        region_size = QEMU_ALIGN_DOWN(region_size, huge_page_size);
+    } else {
+        huge = false;
+        region_size = QEMU_ALIGN_DOWN(region_size, page_size);
+    }
 
     /* A region must have at least 2 pages; one code, one guard */
     g_assert(region_size >= 2 * page_size);
@@ -825,6 +1089,13 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
         void *start, *end;
 
         tcg_region_bounds(i, &start, &end);
+        if (huge) {
+            /*
+             * Leave the guard page unused but accessible: a protection
+             * change would split the mapping and its last huge page.
+             */
+            end += page_size;
+        }
         if (have_prot != need_prot) {
             int rc;
 
@@ -844,7 +1115,7 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
                                  "mprotect of jit buffer");
             }
         }
-        if (have_prot != 0) {
+        if (have_prot != 0 && !huge) {
             /* Guard pages are nice for bug detection but are not essential. */
             (void)qemu_mprotect_none(end, page_size);
         }
@@ -857,6 +1128,7 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
      * This will be the context into which we generate the prologue.
      * It is also the only context for CONFIG_USER_ONLY.
      */
+    tcg_init_ctx.code_gen_node = region.numa ? tcg_region_host_node() : -1;
     tcg_region_initial_alloc__locked(&tcg_init_ctx);
 }
 
@@ -13,6 +13,7 @@
 #include "qemu/osdep.h"
 #include <math.h>
 #include <fenv.h>
+#include "qemu/bitops.h"
 #include "qemu/timer.h"
 #include "qemu/int128.h"
 #include "fpu/softfloat.h"
@@ -34,6 +35,8 @@ enum op {
     OP_FMA,
     OP_SQRT,
     OP_CMP,
+    OP_MIN,
+    OP_TOINT,
     OP_MAX_NR,
 };
 
@@ -45,6 +48,8 @@ static const char * const op_names[] = {
     [OP_FMA] = "mulAdd",
     [OP_SQRT] = "sqrt",
     [OP_CMP] = "cmp",
+    [OP_MIN] = "min",
+    [OP_TOINT] = "toint",
     [OP_MAX_NR] = NULL,
 };
 
@@ -225,6 +230,32 @@ static void fill_random(union fp *ops, int n_ops, enum precision prec,
     }
 }
 
+/*
+ * Give the first operand an exponent in [0, 30], so that it converts
+ * to int32 without overflow.
+ */
+static void limit_int_range(union fp *op, enum precision prec)
+{
+    unsigned int e = op->u64 % 31;
+
+    switch (prec) {
+    case PREC_SINGLE:
+    case PREC_FLOAT32:
+        op->f32 = make_float32(deposit32(op->f32, 23, 8, 127 + e));
+        break;
+    case PREC_DOUBLE:
+    case PREC_FLOAT64:
+        op->f64 = make_float64(deposit64(op->f64, 52, 11, 1023 + e));
+        break;
+    case PREC_QUAD:
+    case PREC_FLOAT128:
+        op->f128.high = deposit64(op->f128.high, 48, 15, 16383 + e);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+}
+
 /*
  * The main benchmark function. Instead of (ab)using macros, we rely
  * on the compiler to unfold this at compile-time.
@@ -242,6 +273,9 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
         switch (prec) {
         case PREC_SINGLE:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TOINT) {
+                limit_int_range(&ops[0], prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float a = ops[0].f;
@@ -270,6 +304,12 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_MIN:
+                    res.f = fminf(a, b);
+                    break;
+                case OP_TOINT:
+                    res.u64 = (int32_t)a;
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -277,6 +317,9 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_DOUBLE:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TOINT) {
+                limit_int_range(&ops[0], prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 double a = ops[0].d;
@@ -305,6 +348,12 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_MIN:
+                    res.d = fmin(a, b);
+                    break;
+                case OP_TOINT:
+                    res.u64 = (int32_t)a;
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -312,6 +361,9 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_FLOAT32:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TOINT) {
+                limit_int_range(&ops[0], prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float32 a = ops[0].f32;
@@ -340,6 +392,12 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float32_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_MIN:
+                    res.f32 = float32_minnum(a, b, &soft_status);
+                    break;
+                case OP_TOINT:
+                    res.u64 = float32_to_int32_round_to_zero(a, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -347,6 +405,9 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_FLOAT64:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TOINT) {
+                limit_int_range(&ops[0], prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float64 a = ops[0].f64;
@@ -375,6 +436,12 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float64_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_MIN:
+                    res.f64 = float64_minnum(a, b, &soft_status);
+                    break;
+                case OP_TOINT:
+                    res.u64 = float64_to_int32_round_to_zero(a, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -382,6 +449,9 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_FLOAT128:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TOINT) {
+                limit_int_range(&ops[0], prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float128 a = ops[0].f128;
@@ -410,6 +480,12 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float128_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_MIN:
+                    res.f128 = float128_minnum(a, b, &soft_status);
+                    break;
+                case OP_TOINT:
+                    res.u64 = float128_to_int32_round_to_zero(a, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -448,6 +524,8 @@ GEN_BENCH_ALL_TYPES(mul, OP_MUL, 2)
 GEN_BENCH_ALL_TYPES(div, OP_DIV, 2)
 GEN_BENCH_ALL_TYPES(fma, OP_FMA, 3)
 GEN_BENCH_ALL_TYPES(cmp, OP_CMP, 2)
+GEN_BENCH_ALL_TYPES(min, OP_MIN, 2)
+GEN_BENCH_ALL_TYPES(toint, OP_TOINT, 1)
 #undef GEN_BENCH_ALL_TYPES
 
 #define GEN_BENCH_ALL_TYPES_NO_NEG(name, op, n)                         \
@@ -480,6 +558,8 @@ static const bench_func_t bench_funcs[OP_MAX_NR][PREC_MAX_NR] = {
     GEN_BENCH_FUNCS(fma, OP_FMA),
     GEN_BENCH_FUNCS(sqrt, OP_SQRT),
     GEN_BENCH_FUNCS(cmp, OP_CMP),
+    GEN_BENCH_FUNCS(min, OP_MIN),
+    GEN_BENCH_FUNCS(toint, OP_TOINT),
 };
 
 #undef GEN_BENCH_FUNCS
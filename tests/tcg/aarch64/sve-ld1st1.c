@@ -0,0 +1,109 @@
+/*
+ * Contiguous SVE loads and stores, with full, partial and sparse
+ * predicates, for each supported vector length.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/prctl.h>
+
+#define N  256
+
+static uint8_t src[N] __attribute__((aligned(256)));
+static uint8_t dst[N] __attribute__((aligned(256)));
+static uint8_t res[N];
+static uint8_t pred[N / 8];
+
+static int check(const char *what, int vl, const uint8_t *exp,
+                 const uint8_t *got, int len)
+{
+    for (int i = 0; i < len; ++i) {
+        if (exp[i] != got[i]) {
+            fprintf(stderr, "%s: vl %d, byte %d, expected %d, got %d\n",
+                    what, vl, i, exp[i], got[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Every other word element active. */
+static void sparse_pred(int vl)
+{
+    memset(pred, 0, sizeof(pred));
+    for (int i = 0; i < vl; i += 8) {
+        pred[i / 8] = 0x01;
+    }
+}
+
+static int test(int vl)
+{
+    uint8_t exp[N];
+    int err = 0;
+
+    /* All true: ld1w, then st1w. */
+    memset(res, 0xaa, sizeof(res));
+    memset(dst, 0x55, sizeof(dst));
+    asm volatile("ptrue p0.s\n\t"
+                 "ld1w { z0.s }, p0/z, [%0]\n\t"
+                 "st1w { z0.s }, p0, [%1]\n\t"
+                 "str z0, [%2]"
+                 : : "r"(src), "r"(dst), "r"(res)
+                 : "z0", "p0", "memory");
+    err |= check("ld1w all", vl, src, res, vl);
+    memcpy(exp, src, vl);
+    memset(exp + vl, 0x55, N - vl);
+    err |= check("st1w all", vl, exp, dst, N);
+
+    /* Sparse predicate: inactive elements load as zero, are not stored. */
+    sparse_pred(vl);
+    memset(dst, 0x55, sizeof(dst));
+    asm volatile("ldr p0, [%3]\n\t"
+                 "ld1w { z0.s }, p0/z, [%0]\n\t"
+                 "st1w { z0.s }, p0, [%1]\n\t"
+                 "str z0, [%2]"
+                 : : "r"(src), "r"(dst), "r"(res), "r"(pred)
+                 : "z0", "p0", "memory");
+    memset(exp, 0x55, N);
+    for (int i = 0; i < vl; i += 8) {
+        memcpy(exp + i, src + i, 4);
+    }
+    err |= check("st1w sparse", vl, exp, dst, N);
+    for (int i = 0; i < vl; i += 8) {
+        memset(exp + i + 4, 0, 4);
+    }
+    err |= check("ld1w sparse", vl, exp, res, vl);
+
+    /* First-fault byte load with a partial predicate. */
+    memset(res, 0xaa, sizeof(res));
+    asm volatile("setffr\n\t"
+                 "whilelo p0.b, xzr, %2\n\t"
+                 "ldff1b { z0.b }, p0/z, [%0]\n\t"
+                 "str z0, [%1]"
+                 : : "r"(src), "r"(res), "r"((long)vl / 2)
+                 : "z0", "p0", "memory");
+    memcpy(exp, src, vl / 2);
+    memset(exp + vl / 2, 0, vl - vl / 2);
+    err |= check("ldff1b partial", vl, exp, res, vl);
+
+    return err;
+}
+
+int main()
+{
+    int err = 0;
+
+    for (int i = 0; i < N; ++i) {
+        src[i] = i * 7 + 3;
+    }
+
+    for (int i = 16; i <= 256; i += 16) {
+        if (prctl(PR_SVE_SET_VL, i, 0, 0, 0, 0) == i) {
+            err |= test(i);
+        }
+    }
+    return err;
+}
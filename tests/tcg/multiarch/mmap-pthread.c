@@ -0,0 +1,208 @@
+/*
+ * Stress concurrent mapping changes and page lookups.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Mapper threads repeatedly map, fill, protect and unmap private chunks
+ * of memory, while prober threads pass valid and protected strings, and
+ * strings inside the chunks of the mappers, to system calls.  This makes
+ * QEMU look up the guest page flags concurrently with the updates.  Each
+ * mapper publishes its chunk with a sequence count, so that a prober can
+ * tell whether the chunk stayed mapped for the whole of its probe, in
+ * which case the probe must succeed.  The elapsed time is printed so
+ * that the test can double as a benchmark, for example:
+ *
+ *   mmap-pthread <mappers> <probers> <iterations>
+ */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHUNK_PAGES 16
+
+struct chunk {
+    char *addr;
+    unsigned seq;       /* odd while addr is mapped */
+};
+
+struct context {
+    int pagesize;
+    int dev_null_fd;
+    int iterations;
+    int n_mappers;
+    char *buf;          /* holds a path, never unmapped */
+    char *noaccess;     /* PROT_NONE, never unmapped */
+    struct chunk *chunks;
+    int next_mapper;
+    volatile int mapper_count;
+};
+
+static void *thread_map(void *arg)
+{
+    struct context *ctx = arg;
+    struct chunk *chunk;
+    size_t len = CHUNK_PAGES * ctx->pagesize;
+    ssize_t sret;
+    char *p;
+    int i, j, ret;
+
+    chunk = &ctx->chunks[__atomic_fetch_add(&ctx->next_mapper, 1,
+                                            __ATOMIC_SEQ_CST)];
+
+    for (i = 0; i < ctx->iterations; i++) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(p != MAP_FAILED);
+
+        for (j = 0; j < CHUNK_PAGES; j++) {
+            strcpy(p + j * ctx->pagesize, "/");
+        }
+        __atomic_store_n(&chunk->addr, p, __ATOMIC_RELAXED);
+        __atomic_store_n(&chunk->seq, chunk->seq + 1, __ATOMIC_RELEASE);
+
+        /* Split the mapping into differently protected ranges. */
+        ret = mprotect(p + (i % CHUNK_PAGES) * ctx->pagesize,
+                       ctx->pagesize, PROT_READ);
+        assert(ret == 0);
+
+        sret = write(ctx->dev_null_fd, p, len);
+        assert(sret == (ssize_t)len);
+
+        __atomic_store_n(&chunk->seq, chunk->seq + 1, __ATOMIC_SEQ_CST);
+        ret = munmap(p, len);
+        assert(ret == 0);
+    }
+
+    __atomic_fetch_sub(&ctx->mapper_count, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+/*
+ * Probe a page of the current chunk of a mapper.  The chunk may be
+ * unmapped at any time, and its address reused by another mapper, so the
+ * string is either "/", empty (a fresh chunk not filled yet) or not
+ * mapped at all.  Only if the chunk was mapped for the whole probe must
+ * the string be found.
+ */
+static void probe_chunk(struct context *ctx, unsigned k)
+{
+    struct chunk *chunk = &ctx->chunks[k % ctx->n_mappers];
+    unsigned seq, seq2;
+    char *p;
+    int ret, err;
+
+    seq = __atomic_load_n(&chunk->seq, __ATOMIC_ACQUIRE);
+    if (!(seq & 1)) {
+        return;
+    }
+    p = __atomic_load_n(&chunk->addr, __ATOMIC_RELAXED);
+    p += (k / ctx->n_mappers) % CHUNK_PAGES * ctx->pagesize;
+
+    ret = access(p, F_OK);
+    err = errno;
+    seq2 = __atomic_load_n(&chunk->seq, __ATOMIC_SEQ_CST);
+
+    if (ret == 0) {
+        return;
+    }
+    if (ret != -1 || seq2 == seq || (err != EFAULT && err != ENOENT)) {
+        fprintf(stderr, "fail chunk read %p (%d, %s)\n",
+                p, ret, strerror(err));
+        abort();
+    }
+}
+
+static void *thread_probe(void *arg)
+{
+    struct context *ctx = arg;
+    unsigned k = 0;
+    int ret;
+
+    while (ctx->mapper_count) {
+        ret = access(ctx->buf, F_OK);
+        if (ret != 0) {
+            fprintf(stderr, "fail read %p (%m)\n", ctx->buf);
+            abort();
+        }
+
+        ret = access(ctx->noaccess, F_OK);
+        if (ret != -1 || errno != EFAULT) {
+            fprintf(stderr, "fail protected read %p (%d)\n",
+                    ctx->noaccess, ret);
+            abort();
+        }
+
+        probe_chunk(ctx, k++);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int n_mappers = argc > 1 ? atoi(argv[1]) : 4;
+    int n_probers = argc > 2 ? atoi(argv[2]) : 4;
+    int n_threads = n_mappers + n_probers;
+    struct timespec start, end;
+    struct context ctx;
+    pthread_t *threads;
+    int i, ret;
+
+    assert(n_mappers > 0 && n_probers >= 0);
+
+    ctx.pagesize = getpagesize();
+    ctx.iterations = argc > 3 ? atoi(argv[3]) : 2000;
+    ctx.n_mappers = n_mappers;
+    ctx.next_mapper = 0;
+    ctx.mapper_count = n_mappers;
+    ctx.chunks = calloc(n_mappers, sizeof(*ctx.chunks));
+    assert(ctx.chunks);
+    ctx.dev_null_fd = open("/dev/null", O_WRONLY);
+    assert(ctx.dev_null_fd >= 0);
+
+    ctx.buf = mmap(NULL, ctx.pagesize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(ctx.buf != MAP_FAILED);
+    strcpy(ctx.buf, "/");
+    ctx.noaccess = mmap(NULL, ctx.pagesize, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(ctx.noaccess != MAP_FAILED);
+
+    threads = calloc(n_threads, sizeof(*threads));
+    assert(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < n_threads; i++) {
+        ret = pthread_create(&threads[i], NULL,
+                             i < n_mappers ? thread_map : thread_probe, &ctx);
+        assert(ret == 0);
+    }
+    for (i = 0; i < n_threads; i++) {
+        ret = pthread_join(threads[i], NULL);
+        assert(ret == 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%d mappers, %d probers, %d iterations: %.3f s\n",
+           n_mappers, n_probers, ctx.iterations,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    free(threads);
+    free(ctx.chunks);
+    ret = munmap(ctx.noaccess, ctx.pagesize);
+    assert(ret == 0);
+    ret = munmap(ctx.buf, ctx.pagesize);
+    assert(ret == 0);
+    close(ctx.dev_null_fd);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+/*
+ * Measure the round-trip latency of simple system calls.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Each thread owns a pipe and repeatedly writes to and reads from it,
+ * and calls getppid(), clock_gettime() and gettimeofday().  The average
+ * latency and throughput of each call are printed, so that the test can
+ * double as a benchmark of the syscall path and of the vDSO, if any, of
+ * a guest architecture, for example:
+ *
+ *   syscall-pthread <threads> <iterations>
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+    CALL_WRITE,
+    CALL_READ,
+    CALL_GETPPID,
+    CALL_CLOCK_GETTIME,
+    CALL_GETTIMEOFDAY,
+    CALL_MAX,
+};
+
+static const char *call_names[CALL_MAX] = {
+    [CALL_WRITE] = "write",
+    [CALL_READ] = "read",
+    [CALL_GETPPID] = "getppid",
+    [CALL_CLOCK_GETTIME] = "clock_gettime",
+    [CALL_GETTIMEOFDAY] = "gettimeofday",
+};
+
+struct context {
+    int iterations;
+    double ns[CALL_MAX];
+};
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 +
+           (end->tv_nsec - start->tv_nsec);
+}
+
+static void *thread_syscall(void *arg)
+{
+    struct context *ctx = arg;
+    struct timespec start, end, ts;
+    struct timeval tv;
+    pid_t ppid = getppid();
+    int fds[2], i, ret;
+    ssize_t sret;
+    char c = 0;
+
+    ret = pipe(fds);
+    assert(ret == 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ctx->iterations; i++) {
+        sret = write(fds[1], &c, 1);
+        assert(sret == 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ctx->ns[CALL_WRITE] = elapsed_ns(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ctx->iterations; i++) {
+        sret = read(fds[0], &c, 1);
+        assert(sret == 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ctx->ns[CALL_READ] = elapsed_ns(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ctx->iterations; i++) {
+        ret = getppid();
+        assert(ret == ppid);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ctx->ns[CALL_GETPPID] = elapsed_ns(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ctx->iterations; i++) {
+        ret = clock_gettime(CLOCK_REALTIME, &ts);
+        assert(ret == 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ctx->ns[CALL_CLOCK_GETTIME] = elapsed_ns(&start, &end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < ctx->iterations; i++) {
+        ret = gettimeofday(&tv, NULL);
+        assert(ret == 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ctx->ns[CALL_GETTIMEOFDAY] = elapsed_ns(&start, &end);
+
+    close(fds[0]);
+    close(fds[1]);
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int n_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10000;
+    struct context *ctx;
+    pthread_t *threads;
+    int i, j, ret;
+
+    /* A pipe must hold all the bytes written before they are read. */
+    assert(n_threads > 0 && iterations > 0 && iterations <= 4096 * 4);
+
+    threads = calloc(n_threads, sizeof(*threads));
+    ctx = calloc(n_threads, sizeof(*ctx));
+    assert(threads && ctx);
+
+    for (i = 0; i < n_threads; i++) {
+        ctx[i].iterations = iterations;
+        ret = pthread_create(&threads[i], NULL, thread_syscall, &ctx[i]);
+        assert(ret == 0);
+    }
+    for (i = 0; i < n_threads; i++) {
+        ret = pthread_join(threads[i], NULL);
+        assert(ret == 0);
+    }
+
+    printf("%d threads, %d iterations\n", n_threads, iterations);
+    for (j = 0; j < CALL_MAX; j++) {
+        double ns = 0;
+
+        for (i = 0; i < n_threads; i++) {
+            ns += ctx[i].ns[j];
+        }
+        ns /= (double)n_threads * iterations;
+        printf("%-16s %8.0f ns %12.0f calls/s\n", call_names[j],
+               ns, 1e9 / ns);
+    }
+
+    free(ctx);
+    free(threads);
+
+    return EXIT_SUCCESS;
+}
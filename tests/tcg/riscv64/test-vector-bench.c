@@ -0,0 +1,152 @@
+/*
+ * Time memcpy, saxpy and dot product kernels written with RVV
+ * instructions, and check their results against scalar code.  The
+ * timings make the test double as a benchmark of the vector load/store
+ * and floating point helpers, for example:
+ *
+ *   test-vector-bench <elements> <iterations>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* With LMUL = 8, v8 and v16 name the register groups v8-v15 and v16-v23. */
+#define CLOBBER_V8 \
+    "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15"
+#define CLOBBER_V16 \
+    "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23"
+
+static void vec_memcpy(uint8_t *d, const uint8_t *s, unsigned long n)
+{
+    while (n) {
+        unsigned long vl;
+
+        asm volatile("vsetvli %0, %1, e8, m8, ta, ma\n\t"
+                     "vle8.v v8, (%2)\n\t"
+                     "vse8.v v8, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(s), "r"(d)
+                     : "memory", CLOBBER_V8);
+        d += vl, s += vl, n -= vl;
+    }
+}
+
+/* y = a * x + y */
+static void vec_saxpy(float *y, const float *x, float a, unsigned long n)
+{
+    while (n) {
+        unsigned long vl;
+
+        asm volatile("vsetvli %0, %1, e32, m8, ta, ma\n\t"
+                     "vle32.v v8, (%2)\n\t"
+                     "vle32.v v16, (%3)\n\t"
+                     "vfmacc.vf v16, %4, v8\n\t"
+                     "vse32.v v16, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(x), "r"(y), "f"(a)
+                     : "memory", CLOBBER_V8, CLOBBER_V16);
+        y += vl, x += vl, n -= vl;
+    }
+}
+
+static float vec_dot(const float *x, const float *y, unsigned long n)
+{
+    float sum = 0;
+
+    while (n) {
+        unsigned long vl;
+        float part;
+
+        asm volatile("vsetvli %0, %2, e32, m8, ta, ma\n\t"
+                     "vle32.v v8, (%3)\n\t"
+                     "vle32.v v16, (%4)\n\t"
+                     "vfmul.vv v8, v8, v16\n\t"
+                     "vfmv.s.f v16, %5\n\t"
+                     "vfredosum.vs v16, v8, v16\n\t"
+                     "vfmv.f.s %1, v16"
+                     : "=&r"(vl), "=f"(part)
+                     : "r"(n), "r"(x), "r"(y), "f"(sum)
+                     : CLOBBER_V8, CLOBBER_V16);
+        sum = part;
+        x += vl, y += vl, n -= vl;
+    }
+    return sum;
+}
+
+static double elapsed_ms(const struct timespec *start,
+                         const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e3 +
+           (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void report(const char *name, const struct timespec *start,
+                   const struct timespec *end, double bytes)
+{
+    double ms = elapsed_ms(start, end);
+
+    printf("%-8s %10.3f ms %10.1f MB/s\n", name, ms, bytes / ms / 1e3);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 4096;
+    int iterations = argc > 2 ? atoi(argv[2]) : 100;
+    struct timespec start, end;
+    float *x, *y, *ref;
+    float a = 0.5f, dot = 0;
+    unsigned long i;
+    int it;
+
+    assert(n > 0 && iterations > 0);
+
+    x = malloc(n * sizeof(float));
+    y = malloc(n * sizeof(float));
+    ref = malloc(n * sizeof(float));
+    assert(x && y && ref);
+
+    /* Small integers keep every sum exact regardless of the order. */
+    for (i = 0; i < n; i++) {
+        x[i] = i % 7;
+        ref[i] = i % 5;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (it = 0; it < iterations; it++) {
+        vec_memcpy((uint8_t *)y, (const uint8_t *)ref, n * sizeof(float));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(memcmp(y, ref, n * sizeof(float)) == 0);
+    report("memcpy", &start, &end, 2.0 * n * sizeof(float) * iterations);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (it = 0; it < iterations; it++) {
+        vec_saxpy(y, x, a, n);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    for (i = 0; i < n; i++) {
+        assert(y[i] == ref[i] + a * x[i] * iterations);
+    }
+    report("saxpy", &start, &end, 3.0 * n * sizeof(float) * iterations);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (it = 0; it < iterations; it++) {
+        dot = vec_dot(x, ref, n);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    for (i = 0; i < n; i++) {
+        dot -= x[i] * ref[i];
+    }
+    assert(dot == 0);
+    report("dot", &start, &end, 2.0 * n * sizeof(float) * iterations);
+
+    free(ref);
+    free(y);
+    free(x);
+
+    return EXIT_SUCCESS;
+}
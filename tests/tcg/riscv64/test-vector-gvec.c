@@ -0,0 +1,163 @@
+/*
+ * Check the GVEC expansions of vmax.vx and friends and of the
+ * vfneg.v/vfabs.v idioms against the scalar results, both with
+ * vl == VLMAX (inline expansion) and with a partial vl (helper).
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#define N 64
+
+static int32_t src[N], dst[N];
+static double fsrc[N], fdst[N];
+
+static unsigned long vsetvl_e32m8(unsigned long avl)
+{
+    unsigned long vl;
+
+    asm volatile("vsetvli %0, %1, e32, m8, ta, ma" : "=r"(vl) : "r"(avl));
+    return vl;
+}
+
+static unsigned long vsetvl_e64m8(unsigned long avl)
+{
+    unsigned long vl;
+
+    asm volatile("vsetvli %0, %1, e64, m8, ta, ma" : "=r"(vl) : "r"(avl));
+    return vl;
+}
+
+/* With LMUL = 8, v8 and v16 name the register groups v8-v15 and v16-v23. */
+#define CLOBBER_V8 \
+    "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15"
+#define CLOBBER_V16 \
+    "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23"
+
+#define VX_OP(NAME, INSN)                                               \
+static void NAME(int32_t *d, const int32_t *s, long x, unsigned long n) \
+{                                                                       \
+    while (n) {                                                         \
+        unsigned long vl = vsetvl_e32m8(n);                             \
+        asm volatile("vle32.v v8, (%0)\n\t"                             \
+                     INSN " v16, v8, %2\n\t"                            \
+                     "vse32.v v16, (%1)"                                \
+                     : : "r"(s), "r"(d), "r"(x)                         \
+                     : "memory", CLOBBER_V8, CLOBBER_V16);              \
+        d += vl, s += vl, n -= vl;                                      \
+    }                                                                   \
+}
+
+VX_OP(vec_max, "vmax.vx")
+VX_OP(vec_min, "vmin.vx")
+VX_OP(vec_maxu, "vmaxu.vx")
+VX_OP(vec_minu, "vminu.vx")
+
+/* vd == vs2 must not take the splat path. */
+static void vec_max_inplace(int32_t *d, long x, unsigned long n)
+{
+    while (n) {
+        unsigned long vl = vsetvl_e32m8(n);
+        asm volatile("vle32.v v8, (%0)\n\t"
+                     "vmax.vx v8, v8, %1\n\t"
+                     "vse32.v v8, (%0)"
+                     : : "r"(d), "r"(x) : "memory", CLOBBER_V8);
+        d += vl, n -= vl;
+    }
+}
+
+#define FV_OP(NAME, INSN)                                               \
+static void NAME(double *d, const double *s, unsigned long n)           \
+{                                                                       \
+    while (n) {                                                         \
+        unsigned long vl = vsetvl_e64m8(n);                             \
+        asm volatile("vle64.v v8, (%0)\n\t"                             \
+                     INSN " v16, v8, v8\n\t"                            \
+                     "vse64.v v16, (%1)"                                \
+                     : : "r"(s), "r"(d)                                 \
+                     : "memory", CLOBBER_V8, CLOBBER_V16);              \
+        d += vl, s += vl, n -= vl;                                      \
+    }                                                                   \
+}
+
+FV_OP(vec_fmv, "vfsgnj.vv")
+FV_OP(vec_fneg, "vfsgnjn.vv")
+FV_OP(vec_fabs, "vfsgnjx.vv")
+
+static void check_int(unsigned long n)
+{
+    static const long xs[] = { 0, 5, -5, 0x7fffffff, -0x80000000L };
+    int32_t expect;
+
+    for (int k = 0; k < sizeof(xs) / sizeof(xs[0]); k++) {
+        int32_t x = xs[k];
+
+        memset(dst, 0x55, sizeof(dst));
+        vec_max(dst, src, xs[k], n);
+        for (int i = 0; i < n; i++) {
+            assert(dst[i] == (src[i] > x ? src[i] : x));
+        }
+        vec_min(dst, src, xs[k], n);
+        for (int i = 0; i < n; i++) {
+            assert(dst[i] == (src[i] < x ? src[i] : x));
+        }
+        vec_maxu(dst, src, xs[k], n);
+        for (int i = 0; i < n; i++) {
+            expect = (uint32_t)src[i] > (uint32_t)x ? src[i] : x;
+            assert(dst[i] == expect);
+        }
+        vec_minu(dst, src, xs[k], n);
+        for (int i = 0; i < n; i++) {
+            expect = (uint32_t)src[i] < (uint32_t)x ? src[i] : x;
+            assert(dst[i] == expect);
+        }
+        memcpy(dst, src, sizeof(dst));
+        vec_max_inplace(dst, xs[k], n);
+        for (int i = 0; i < n; i++) {
+            assert(dst[i] == (src[i] > x ? src[i] : x));
+        }
+    }
+}
+
+static void check_fp(unsigned long n)
+{
+    vec_fmv(fdst, fsrc, n);
+    assert(memcmp(fdst, fsrc, n * sizeof(double)) == 0);
+
+    vec_fneg(fdst, fsrc, n);
+    for (int i = 0; i < n; i++) {
+        uint64_t a, b;
+        memcpy(&a, &fsrc[i], 8);
+        memcpy(&b, &fdst[i], 8);
+        assert(b == (a ^ (1ull << 63)));
+    }
+
+    vec_fabs(fdst, fsrc, n);
+    for (int i = 0; i < n; i++) {
+        uint64_t a, b;
+        memcpy(&a, &fsrc[i], 8);
+        memcpy(&b, &fdst[i], 8);
+        assert(b == (a & ~(1ull << 63)));
+    }
+}
+
+int main(void)
+{
+    for (int i = 0; i < N; i++) {
+        src[i] = (i * 0x9e3779b9u) ^ (i << 28);
+        fsrc[i] = (i & 1 ? -1.5 : 2.25) * i;
+    }
+    /* Include a NaN and a negative zero; only the sign may change. */
+    memcpy(&fsrc[3], &(uint64_t){ 0xfff8000000000001ull }, 8);
+    fsrc[5] = -0.0;
+
+    /* Full vectors, then lengths that leave a partial tail. */
+    check_int(N);
+    check_int(N - 3);
+    check_fp(N);
+    check_fp(N - 3);
+    return 0;
+}